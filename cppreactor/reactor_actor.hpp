@@ -0,0 +1,384 @@
+#ifndef REACTOR_ACTOR_HPP_INCLUDED
+#define REACTOR_ACTOR_HPP_INCLUDED
+
+#include "reactor_coroutine.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace cppcoro
+{
+	template <class Msg, class T = reactor_default_frame_data, class... Policies>
+	class reactor_mailbox;
+
+	template <class Msg>
+	class reactor_mailbox_batch;
+
+	namespace detail
+	{
+		template <class Msg>
+		struct mailbox_node
+		{
+			Msg& message()
+			{
+				return *reinterpret_cast<Msg*>(&m_storage);
+			}
+
+			typename std::aligned_storage<sizeof(Msg), alignof(Msg)>::type m_storage;
+			mailbox_node* m_next;
+		};
+
+		// Nodes are allocated in blocks and recycled, posting only allocates when more
+		// messages are in flight than ever before
+		template <class Msg>
+		class mailbox_node_pool
+		{
+		public:
+			explicit mailbox_node_pool(std::size_t capacity)
+				: m_free(nullptr), m_capacity(0)
+			{
+				grow(capacity > 0 ? capacity : 1);
+			}
+
+			mailbox_node_pool(const mailbox_node_pool&) = delete;
+			mailbox_node_pool& operator=(const mailbox_node_pool&) = delete;
+
+			mailbox_node<Msg>* acquire()
+			{
+				if (!m_free)
+				{
+					grow(m_capacity);
+				}
+
+				auto node = m_free;
+				m_free = node->m_next;
+				node->m_next = nullptr;
+				return node;
+			}
+
+			// Messages must already be destroyed
+			void release(mailbox_node<Msg>* first, mailbox_node<Msg>* last)
+			{
+				last->m_next = m_free;
+				m_free = first;
+			}
+
+			std::size_t capacity() const
+			{
+				return m_capacity;
+			}
+
+		private:
+			void grow(std::size_t count)
+			{
+				std::unique_ptr<mailbox_node<Msg>[]> block(new mailbox_node<Msg>[count]);
+				for (std::size_t i = 0; i < count; i++)
+				{
+					block[i].m_next = i + 1 < count ? &block[i + 1] : m_free;
+				}
+				m_free = &block[0];
+				m_capacity += count;
+				m_blocks.push_back(std::move(block));
+			}
+
+			std::vector<std::unique_ptr<mailbox_node<Msg>[]> > m_blocks;
+			mailbox_node<Msg>* m_free;
+			std::size_t m_capacity;
+		};
+	}
+
+	// All messages that were pending when receiver was resumed, nodes return to the pool when batch is destroyed
+	template <class Msg>
+	class reactor_mailbox_batch
+	{
+	public:
+		class iterator
+		{
+		public:
+			explicit iterator(detail::mailbox_node<Msg>* node)
+				: m_node(node)
+			{
+			}
+
+			Msg& operator*() const
+			{
+				return m_node->message();
+			}
+
+			Msg* operator->() const
+			{
+				return &m_node->message();
+			}
+
+			iterator& operator++()
+			{
+				m_node = m_node->m_next;
+				return *this;
+			}
+
+			bool operator==(const iterator& other) const
+			{
+				return m_node == other.m_node;
+			}
+
+			bool operator!=(const iterator& other) const
+			{
+				return m_node != other.m_node;
+			}
+
+		private:
+			detail::mailbox_node<Msg>* m_node;
+		};
+
+		reactor_mailbox_batch() noexcept
+			: m_first(nullptr), m_last(nullptr), m_size(0), m_pool(nullptr)
+		{
+		}
+
+		reactor_mailbox_batch(reactor_mailbox_batch&& other) noexcept
+			: m_first(other.m_first), m_last(other.m_last), m_size(other.m_size), m_pool(other.m_pool)
+		{
+			other.m_first = other.m_last = nullptr;
+			other.m_size = 0;
+		}
+
+		reactor_mailbox_batch(const reactor_mailbox_batch&) = delete;
+
+		reactor_mailbox_batch& operator=(reactor_mailbox_batch other) noexcept
+		{
+			swap(other);
+			return *this;
+		}
+
+		~reactor_mailbox_batch()
+		{
+			if (m_first)
+			{
+				for (auto node = m_first; node; node = node->m_next)
+				{
+					node->message().~Msg();
+				}
+				m_pool->release(m_first, m_last);
+			}
+		}
+
+		void swap(reactor_mailbox_batch& other) noexcept
+		{
+			std::swap(m_first, other.m_first);
+			std::swap(m_last, other.m_last);
+			std::swap(m_size, other.m_size);
+			std::swap(m_pool, other.m_pool);
+		}
+
+		iterator begin() const
+		{
+			return iterator{ m_first };
+		}
+
+		iterator end() const
+		{
+			return iterator{ nullptr };
+		}
+
+		std::size_t size() const
+		{
+			return m_size;
+		}
+
+		bool empty() const
+		{
+			return m_size == 0;
+		}
+
+	private:
+		template <class U, class V, class... P>
+		friend class reactor_mailbox;
+
+		reactor_mailbox_batch(detail::mailbox_node<Msg>* first, detail::mailbox_node<Msg>* last, std::size_t size, detail::mailbox_node_pool<Msg>* pool)
+			: m_first(first), m_last(last), m_size(size), m_pool(pool)
+		{
+		}
+
+		detail::mailbox_node<Msg>* m_first;
+		detail::mailbox_node<Msg>* m_last;
+		std::size_t m_size;
+		detail::mailbox_node_pool<Msg>* m_pool;
+	};
+
+	// Single receiver message queue. Receiver is resumed at most once per frame and gets everything
+	// posted since its last resume in one batch.
+	template <class Msg, class T, class... Policies>
+	class reactor_mailbox
+	{
+	public:
+		class receive_awaitable
+		{
+		public:
+			static constexpr const char* awaitable_name = "reactor_mailbox";
+
+			explicit receive_awaitable(reactor_mailbox& mailbox)
+				: m_mailbox(&mailbox)
+			{
+			}
+
+			bool await_ready() const noexcept
+			{
+				return false;
+			}
+
+			// Pending messages are delivered next frame, so a receiving loop never spins inside one frame
+			void await_suspend(detail::coro::coroutine_handle<> awaitingCoroutine)
+			{
+				assert(!m_mailbox->m_receiver);
+				m_node.m_handle = awaitingCoroutine;
+				if (m_mailbox->m_first)
+				{
+					m_mailbox->m_scheduler->enqueue_update(m_node, "reactor_mailbox");
+				}
+				else
+				{
+					m_mailbox->m_receiver = &m_node;
+				}
+			}
+
+			reactor_mailbox_batch<Msg> await_resume()
+			{
+				return m_mailbox->take();
+			}
+
+		private:
+			reactor_mailbox* m_mailbox;
+			reactor_frame_node m_node;
+		};
+
+		explicit reactor_mailbox(reactor_scheduler<T, Policies...>& scheduler, std::size_t capacity = 64)
+			: m_scheduler(&scheduler), m_pool(capacity), m_first(nullptr), m_last(nullptr), m_size(0), m_receiver(nullptr)
+		{
+		}
+
+		reactor_mailbox(const reactor_mailbox&) = delete;
+		reactor_mailbox& operator=(const reactor_mailbox&) = delete;
+
+		~reactor_mailbox()
+		{
+			take();
+		}
+
+		template <class... Args>
+		void post(Args&&... args)
+		{
+			auto node = m_pool.acquire();
+			new (&node->m_storage) Msg(std::forward<Args>(args)...);
+
+			if (m_last)
+			{
+				m_last->m_next = node;
+			}
+			else
+			{
+				m_first = node;
+			}
+			m_last = node;
+			m_size++;
+
+			if (m_receiver)
+			{
+				m_scheduler->enqueue_update(*m_receiver, "reactor_mailbox");
+				m_receiver = nullptr;
+			}
+		}
+
+		receive_awaitable receive_batch()
+		{
+			return receive_awaitable{ *this };
+		}
+
+		std::size_t size() const
+		{
+			return m_size;
+		}
+
+		bool empty() const
+		{
+			return m_size == 0;
+		}
+
+	private:
+		reactor_mailbox_batch<Msg> take()
+		{
+			reactor_mailbox_batch<Msg> batch{ m_first, m_last, m_size, &m_pool };
+			m_first = m_last = nullptr;
+			m_size = 0;
+			return batch;
+		}
+
+		reactor_scheduler<T, Policies...>* m_scheduler;
+		detail::mailbox_node_pool<Msg> m_pool;
+		detail::mailbox_node<Msg>* m_first;
+		detail::mailbox_node<Msg>* m_last;
+		std::size_t m_size;
+		reactor_frame_node* m_receiver;
+	};
+
+	// Actor owning its mailbox and message loop. Override receive to handle messages one by one,
+	// or run to write own loop over mailbox().
+	template <class Msg, class T = reactor_default_frame_data, class... Policies>
+	class reactor_actor
+	{
+	public:
+		explicit reactor_actor(reactor_scheduler<T, Policies...>& scheduler, std::size_t capacity = 64)
+			: m_scheduler(&scheduler), m_mailbox(scheduler, capacity)
+		{
+		}
+
+		reactor_actor(const reactor_actor&) = delete;
+		reactor_actor& operator=(const reactor_actor&) = delete;
+
+		virtual ~reactor_actor() = default;
+
+		// Loop starts in next scheduler update, messages posted before are not lost
+		void start()
+		{
+			m_loop = run();
+			m_scheduler->push(m_loop);
+		}
+
+		template <class... Args>
+		void post(Args&&... args)
+		{
+			m_mailbox.post(std::forward<Args>(args)...);
+		}
+
+	protected:
+		virtual reactor_coroutine<T, Policies...> run()
+		{
+			for (;;)
+			{
+				auto batch = co_await m_mailbox.receive_batch();
+				for (auto& message : batch)
+				{
+					receive(message);
+				}
+			}
+		}
+
+		virtual void receive(Msg& /*message*/)
+		{
+		}
+
+		reactor_mailbox<Msg, T, Policies...>& mailbox()
+		{
+			return m_mailbox;
+		}
+
+	private:
+		reactor_scheduler<T, Policies...>* m_scheduler;
+		reactor_mailbox<Msg, T, Policies...> m_mailbox;
+		reactor_coroutine<T, Policies...> m_loop;
+	};
+}
+
+#endif
@@ -0,0 +1,161 @@
+#ifndef REACTOR_BACKTRACE_HPP_INCLUDED
+#define REACTOR_BACKTRACE_HPP_INCLUDED
+
+#include "reactor_coroutine.hpp"
+
+#include <cstddef>
+#include <ostream>
+
+namespace cppcoro
+{
+	// Instrumentation policy keeping every live coroutine with the coroutine it awaits, so a stalled
+	// frame can be explained as "A awaits B awaits C which waits on next_frame". Bookkeeping is a few
+	// pointer stores per await and dump walks the live list without allocating. Call dump between
+	// frames on the scheduler thread, a signal handler should only set a flag for it.
+	class reactor_backtrace : public reactor_instrumentation
+	{
+	public:
+		struct coroutine_data
+		{
+			coroutine_data* m_previous = nullptr;
+			coroutine_data* m_next = nullptr;
+			coroutine_data* m_parent = nullptr;
+			coroutine_data* m_child = nullptr;
+
+			const void* m_coroutine = nullptr;
+			const char* m_function = "";
+			const char* m_file = "";
+			unsigned m_line = 0;
+
+			// Awaitable kind, null while running
+			const char* m_awaiting = nullptr;
+		};
+
+		reactor_backtrace()
+			: m_live(nullptr), m_awaiting_parent(nullptr), m_count(0)
+		{
+		}
+
+		reactor_backtrace(const reactor_backtrace&) = delete;
+		reactor_backtrace& operator=(const reactor_backtrace&) = delete;
+
+		// Live coroutines that were pushed or awaited
+		std::size_t size() const
+		{
+			return m_count;
+		}
+
+		// One block per coroutine pushed to the scheduler, every awaited child indented below its awaiter
+		void dump(std::ostream& out) const
+		{
+			for (auto data = m_live; data; data = data->m_next)
+			{
+				if (data->m_parent)
+				{
+					continue;
+				}
+
+				std::size_t depth = 0;
+				for (auto link = data; link; link = link->m_child, ++depth)
+				{
+					for (std::size_t i = 0; i < depth; i++)
+					{
+						out << "  ";
+					}
+					out << "#" << depth << " " << link->m_coroutine << " " << link->m_function
+						<< " (" << link->m_file << ":" << link->m_line << ") ";
+
+					if (link->m_awaiting)
+					{
+						out << "awaits " << link->m_awaiting << "\n";
+					}
+					else
+					{
+						out << "running\n";
+					}
+				}
+			}
+		}
+
+		static void on_create(coroutine_data& data, const detail::source_location& location)
+		{
+			data.m_function = location.function_name();
+			data.m_file = location.file_name();
+			data.m_line = location.line();
+		}
+
+		void on_schedule(coroutine_data& data, const void* address)
+		{
+			data.m_coroutine = address;
+			data.m_awaiting = "start";
+
+			// Child is scheduled right after its awaiter suspends
+			data.m_parent = m_awaiting_parent;
+			if (m_awaiting_parent)
+			{
+				m_awaiting_parent->m_child = &data;
+				m_awaiting_parent = nullptr;
+			}
+
+			data.m_next = m_live;
+			if (m_live)
+			{
+				m_live->m_previous = &data;
+			}
+			m_live = &data;
+			++m_count;
+		}
+
+		void on_resume(coroutine_data& data, bool)
+		{
+			data.m_awaiting = nullptr;
+		}
+
+		void on_await(coroutine_data& data, const char* awaitable)
+		{
+			data.m_awaiting = awaitable;
+		}
+
+		void on_suspend(coroutine_data& data, bool child)
+		{
+			if (child)
+			{
+				m_awaiting_parent = &data;
+			}
+		}
+
+		void on_destroy(coroutine_data& data)
+		{
+			if (data.m_parent && data.m_parent->m_child == &data)
+			{
+				data.m_parent->m_child = nullptr;
+			}
+			if (data.m_child)
+			{
+				data.m_child->m_parent = nullptr;
+			}
+
+			if (data.m_previous)
+			{
+				data.m_previous->m_next = data.m_next;
+			}
+			else
+			{
+				m_live = data.m_next;
+			}
+
+			if (data.m_next)
+			{
+				data.m_next->m_previous = data.m_previous;
+			}
+			--m_count;
+		}
+
+	private:
+		coroutine_data* m_live;
+		coroutine_data* m_awaiting_parent;
+		std::size_t m_count;
+	};
+}
+
+#endif
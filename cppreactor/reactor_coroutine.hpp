@@ -1,181 +1,1370 @@
 #ifndef REACTOR_COROUTINE_HPP_INCLUDED
 #define REACTOR_COROUTINE_HPP_INCLUDED
 
-#include <experimental/coroutine>
 #include <type_traits>
 #include <utility>
 #include <exception>
+#include <tuple>
+#include <cstdint>
+#include <vector>
+#include <cassert>
+#include <memory>
+#include <mutex>
+#include <new>
+
+// MSVC with /await only ships the Coroutine TS header, standard compilers ship <coroutine>
+#if __has_include(<coroutine>) && !defined(_RESUMABLE_FUNCTIONS_SUPPORTED)
+#include <coroutine>
+namespace cppcoro { namespace detail { namespace coro = std; } }
+#else
+#include <experimental/coroutine>
+namespace cppcoro { namespace detail { namespace coro = std::experimental; } }
+#endif
+
+#if __has_include(<source_location>)
+#include <source_location>
+#endif
+
+namespace cppcoro
+{
+	namespace detail
+	{
+#if defined(__cpp_lib_source_location)
+		using source_location = std::source_location;
+#else
+		struct source_location
+		{
+			static constexpr source_location current() noexcept
+			{
+				return {};
+			}
+
+			constexpr const char* file_name() const noexcept
+			{
+				return "";
+			}
+
+			constexpr const char* function_name() const noexcept
+			{
+				return "";
+			}
+
+			constexpr unsigned line() const noexcept
+			{
+				return 0;
+			}
+		};
+#endif
+	}
+}
+
+// Policy state that is empty must not take space in promises and schedulers
+#if defined(_MSC_VER) && !defined(__clang__)
+#define REACTOR_NO_UNIQUE_ADDRESS [[msvc::no_unique_address]]
+#else
+#define REACTOR_NO_UNIQUE_ADDRESS [[no_unique_address]]
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>
+#endif
+
+namespace cppcoro
+{
+	namespace detail
+	{
+		// Starts loading memory that is read soon, does nothing where no hint is available
+		inline void prefetch(const void* address) noexcept
+		{
+#if defined(_MSC_VER) && !defined(__clang__) && (defined(_M_X64) || defined(_M_IX86))
+			_mm_prefetch(static_cast<const char*>(address), _MM_HINT_T0);
+#elif defined(__GNUC__) || defined(__clang__)
+			__builtin_prefetch(address);
+#else
+			(void)address;
+#endif
+		}
+	}
+}
+
+namespace cppcoro
+{
+	struct reactor_default_frame_data
+	{
+	};
+
+	// Scheduler, coroutines and awaited children have to share the same policies
+	template <class T = reactor_default_frame_data, class... Policies>
+	class reactor_scheduler;
+
+	template <class T = reactor_default_frame_data, class... Policies>
+	class reactor_coroutine;
+
+	template <class R, class T = reactor_default_frame_data, class... Policies>
+	class reactor_coroutine_return;
+
+	template <class R, class T = reactor_default_frame_data, class... Policies>
+	class reactor_shared_coroutine_return;
+
+	template <class Y, class T = reactor_default_frame_data, class... Policies>
+	class reactor_generator;
+
+	template <class T = reactor_default_frame_data, class... Policies>
+	class next_frame;
+
+	namespace detail
+	{
+		template <class A>
+		struct is_next_frame : std::false_type
+		{
+		};
+
+		template <class T, class... Policies>
+		struct is_next_frame<next_frame<T, Policies...> > : std::true_type
+		{
+		};
+	}
+
+	class reactor_stats;
+	class reactor_backtrace;
+
+	// Base of instrumentation policies. Scheduler owns one instance of every instrumentation policy
+	// it was given and every coroutine carries its coroutine_data. Policies hide the hooks they need.
+	class reactor_instrumentation
+	{
+	public:
+		struct coroutine_data
+		{
+		};
+
+		// Coroutine was created, location is its function. Runs before the coroutine has a scheduler.
+		template <class D>
+		static void on_create(D&, const detail::source_location& /*location*/) {}
+
+		void begin_frame() {}
+		void end_frame() {}
+
+		// Handles resumed this frame, pushed coroutines included
+		void on_frame_queue(std::size_t /*queued*/) {}
+
+		// Handle was queued for the next frame, source names the kind of awaitable that queued it
+		void on_enqueue(const char* /*source*/) {}
+
+		// Around resume of the handle at given position of the frame queue
+		void before_resume(std::size_t /*index*/) {}
+		void after_resume(std::size_t /*index*/) {}
+
+		// Coroutine was pushed to a scheduler or awaited by another coroutine
+		template <class D>
+		void on_schedule(D&, const void* /*address*/) {}
+
+		// Coroutine got control, child is true when it returns from awaiting a child coroutine
+		template <class D>
+		void on_resume(D&, bool /*child*/) {}
+
+		// Coroutine gave control up, child is true when it starts awaiting a child coroutine
+		template <class D>
+		void on_suspend(D&, bool /*child*/) {}
+
+		// Coroutine is about to suspend on given kind of awaitable, completed_awaitable at its final suspend
+		template <class D>
+		void on_await(D&, const char* /*awaitable*/) {}
+
+		// Awaitable name passed at final suspend, one object so policies can compare the pointer
+		static constexpr char completed_awaitable[] = "completed";
+
+		template <class D>
+		void on_destroy(D&) {}
+	};
+
+	// Link of a handle queued for the next frame. Awaitables keep it in the suspended coroutine frame,
+	// with reactor_intrusive_queue queueing it is a pointer store and never allocates.
+	struct reactor_frame_node
+	{
+		reactor_frame_node* m_next = nullptr;
+		detail::coro::coroutine_handle<> m_handle;
+	};
+
+	// Nodes queued together, for example all waiters of one event
+	struct reactor_frame_list
+	{
+		reactor_frame_node* m_first = nullptr;
+		reactor_frame_node* m_last = nullptr;
+		std::size_t m_size = 0;
+
+		bool empty() const
+		{
+			return m_first == nullptr;
+		}
+
+		std::size_t size() const
+		{
+			return m_size;
+		}
+
+		void push_back(reactor_frame_node& node)
+		{
+			node.m_next = nullptr;
+			if (m_last)
+			{
+				m_last->m_next = &node;
+			}
+			else
+			{
+				m_first = &node;
+			}
+			m_last = &node;
+			++m_size;
+		}
+
+		// Moves all nodes of other to the end, other is left empty
+		void splice(reactor_frame_list& other)
+		{
+			if (other.empty())
+			{
+				return;
+			}
+			if (m_last)
+			{
+				m_last->m_next = other.m_first;
+			}
+			else
+			{
+				m_first = other.m_first;
+			}
+			m_last = other.m_last;
+			m_size += other.m_size;
+			other.clear();
+		}
+
+		void clear()
+		{
+			m_first = m_last = nullptr;
+			m_size = 0;
+		}
+	};
+
+	namespace detail
+	{
+		// Default frame queue, handles are copied out of their nodes into a growing array
+		class vector_frame_queue
+		{
+		public:
+			static constexpr bool intrusive = false;
+
+			std::size_t size() const
+			{
+				return m_handles.size();
+			}
+
+			std::size_t capacity() const
+			{
+				return m_handles.capacity();
+			}
+
+			void reserve(std::size_t handles)
+			{
+				m_handles.reserve(handles);
+			}
+
+			void push(coro::coroutine_handle<> handle)
+			{
+				m_handles.push_back(handle);
+			}
+
+			void push(reactor_frame_node& node)
+			{
+				m_handles.push_back(node.m_handle);
+			}
+
+			coro::coroutine_handle<> operator[](std::size_t index) const
+			{
+				return m_handles[index];
+			}
+
+			// Queue order is the resume order
+			void group()
+			{
+			}
+
+			// Position in which the handle was queued
+			std::size_t index(std::size_t position) const
+			{
+				return position;
+			}
+
+			void clear()
+			{
+				m_handles.clear();
+			}
+
+		private:
+			std::vector<coro::coroutine_handle<> > m_handles;
+		};
+
+		// Handle array reordered before every frame so handles resuming the same coroutine body run
+		// back to back, each group in queue order. Groups run in the order their bodies were first queued
+		// on this scheduler, not the order they show up in this frame, so the order stays fixed. Body is the
+		// resume address at the start of the frame, where GCC, Clang and MSVC all place it. It is read
+		// when the handle is queued, right after its coroutine ran and while its frame is in cache.
+		class grouped_frame_queue
+		{
+		public:
+			static constexpr bool intrusive = false;
+
+			grouped_frame_queue()
+				: m_bodies(0), m_last_body(nullptr), m_last_group(0), m_sorted(true)
+			{
+			}
+
+			std::size_t size() const
+			{
+				return m_handles.size();
+			}
+
+			std::size_t capacity() const
+			{
+				return m_handles.capacity();
+			}
+
+			void reserve(std::size_t handles)
+			{
+				m_handles.reserve(handles);
+				m_grouped.reserve(handles);
+				m_groups.reserve(handles);
+				m_order.reserve(handles);
+			}
+
+			void push(coro::coroutine_handle<> handle)
+			{
+				auto group = group_of(*static_cast<void* const*>(handle.address()));
+				m_sorted = m_sorted && (m_groups.empty() || m_groups.back() <= group);
+				m_handles.push_back(handle);
+				m_groups.push_back(group);
+			}
+
+			void push(reactor_frame_node& node)
+			{
+				push(node.m_handle);
+			}
+
+			coro::coroutine_handle<> operator[](std::size_t index) const
+			{
+				return m_handles[index];
+			}
+
+			// Stable counting sort by group, linear in handles and without touching their frames. Handles
+			// resumed in groups queue themselves in groups again, so a steady state needs no sorting.
+			void group()
+			{
+				if (m_sorted)
+				{
+					return;
+				}
+
+				const auto size = m_handles.size();
+				m_offsets.assign(m_bodies + 1, 0);
+				for (auto group : m_groups)
+				{
+					++m_offsets[group + 1];
+				}
+				for (std::size_t i = 1; i < m_offsets.size(); i++)
+				{
+					m_offsets[i] += m_offsets[i - 1];
+				}
+
+				m_grouped.resize(size);
+				m_order.resize(size);
+				for (std::size_t i = 0; i < size; i++)
+				{
+					auto position = m_offsets[m_groups[i]]++;
+					m_grouped[position] = m_handles[i];
+					m_order[position] = i;
+				}
+				m_handles.swap(m_grouped);
+			}
+
+			std::size_t index(std::size_t position) const
+			{
+				return position < m_order.size() ? m_order[position] : position;
+			}
+
+			void clear()
+			{
+				m_handles.clear();
+				m_groups.clear();
+				m_order.clear();
+				m_sorted = true;
+			}
+
+			// Distinct coroutine bodies seen so far
+			std::size_t bodies() const
+			{
+				return m_bodies;
+			}
+
+		private:
+			// Open addressing table from body to group, grows only when a new body shows up
+			std::uint32_t group_of(const void* body)
+			{
+				// Grouped resumes queue their next frame in groups too
+				if (body == m_last_body)
+				{
+					return m_last_group;
+				}
+				m_last_body = body;
+				m_last_group = lookup(body);
+				return m_last_group;
+			}
+
+			std::uint32_t lookup(const void* body)
+			{
+				if (2 * (m_bodies + 1) > m_table.size())
+				{
+					rehash(m_table.empty() ? 64 : 2 * m_table.size());
+				}
+
+				auto mask = m_table.size() - 1;
+				for (auto slot = hash(body) & mask;; slot = (slot + 1) & mask)
+				{
+					auto& entry = m_table[slot];
+					if (entry.first == body)
+					{
+						return entry.second;
+					}
+					if (!entry.first)
+					{
+						entry = { body, static_cast<std::uint32_t>(m_bodies++) };
+						return entry.second;
+					}
+				}
+			}
+
+			void rehash(std::size_t size)
+			{
+				std::vector<std::pair<const void*, std::uint32_t> > table(size, { nullptr, 0 });
+				for (auto& entry : m_table)
+				{
+					if (entry.first)
+					{
+						for (auto slot = hash(entry.first) & (size - 1);; slot = (slot + 1) & (size - 1))
+						{
+							if (!table[slot].first)
+							{
+								table[slot] = entry;
+								break;
+							}
+						}
+					}
+				}
+				m_table.swap(table);
+			}
+
+			static std::size_t hash(const void* body)
+			{
+				auto value = reinterpret_cast<std::uintptr_t>(body);
+				return static_cast<std::size_t>((value >> 4) * 0x9E3779B97F4A7C15ull >> 32);
+			}
+
+			std::vector<coro::coroutine_handle<> > m_handles;
+			std::vector<coro::coroutine_handle<> > m_grouped;
+			std::vector<std::uint32_t> m_groups;
+			std::vector<std::size_t> m_order;
+			std::vector<std::size_t> m_offsets;
+			std::vector<std::pair<const void*, std::uint32_t> > m_table;
+			std::size_t m_bodies;
+			const void* m_last_body;
+			std::uint32_t m_last_group;
+			bool m_sorted;
+		};
+
+		// Frame queue linking nodes of suspended awaiters, whole lists are spliced in constant time
+		class intrusive_frame_queue
+		{
+		public:
+			static constexpr bool intrusive = true;
+
+			std::size_t size() const
+			{
+				return m_nodes.size();
+			}
+
+			void reserve(std::size_t)
+			{
+			}
+
+			void push(reactor_frame_node& node)
+			{
+				m_nodes.push_back(node);
+			}
+
+			void push(reactor_frame_list& nodes)
+			{
+				m_nodes.splice(nodes);
+			}
+
+			reactor_frame_list& nodes()
+			{
+				return m_nodes;
+			}
+
+			void clear()
+			{
+				m_nodes.clear();
+			}
+
+		private:
+			reactor_frame_list m_nodes;
+		};
+	}
+
+	// Base of queue policies, scheduler keeps handles of the next frame in the policy's queue_type
+	class reactor_queue_policy
+	{
+	};
+
+	// Queued awaiters are linked through nodes in their own frames instead of being copied to a
+	// growing array. Handles without a node cannot be queued, so enqueue_update takes nodes only.
+	class reactor_intrusive_queue : public reactor_queue_policy
+	{
+	public:
+		typedef detail::intrusive_frame_queue queue_type;
+	};
+
+	// Every frame resumes all ready instances of one coroutine body before the next body, so a
+	// workload with many coroutine kinds does not jump between their code on every resume
+	class reactor_grouped_queue : public reactor_queue_policy
+	{
+	public:
+		typedef detail::grouped_frame_queue queue_type;
+	};
+
+	// Base of fixed capacity policies. Scheduler with one never grows its frame queues past the
+	// capacity given to reserve(). A handle over it would never be resumed again, so it is reported
+	// to the policy and the process is terminated with std::terminate:
+	//   void on_queue_overflow(const char* source);
+	class reactor_fixed_capacity
+	{
+	};
+
+	// Base of frame allocator policies, coroutine frames come from the policy instead of the global heap:
+	//   static void* allocate_frame(std::size_t size);
+	//   static void deallocate_frame(void* frame, std::size_t size) noexcept;
+	class reactor_frame_allocator
+	{
+	};
+
+	// Base of threading policies. Without one the scheduler belongs to a single thread, with one
+	// enqueue_update may be called from other threads and the policy guards the next frame queue:
+	//   void lock();
+	//   void unlock();
+	class reactor_threading_policy
+	{
+	};
+
+	// Next frame queue guarded by a mutex, so completions from other threads can wake coroutines.
+	// Coroutines are still created, pushed and resumed on the scheduler thread only.
+	class reactor_thread_safe_enqueue : public reactor_threading_policy
+	{
+	public:
+		void lock()
+		{
+			m_mutex.lock();
+		}
+
+		void unlock()
+		{
+			m_mutex.unlock();
+		}
+
+	private:
+		std::mutex m_mutex;
+	};
+
+	// Base of error policies, deciding what an exception escaping a coroutine pushed to the scheduler
+	// does. Without one it is thrown out of update_next_frame. Policy is called inside the handler,
+	// it may rethrow, otherwise the coroutine completes and the frame goes on:
+	//   void on_unhandled_exception(const void* coroutine);
+	class reactor_error_policy
+	{
+	public:
+		// Called before any coroutine of the frame is resumed
+		void begin_frame() {}
+	};
+
+	// Exception escaping a pushed coroutine terminates the process
+	class reactor_error_terminate : public reactor_error_policy
+	{
+	public:
+		void on_unhandled_exception(const void*)
+		{
+			std::terminate();
+		}
+	};
+
+	// Error policy for code built without exceptions. Promises keep no exception_ptr, completions and
+	// the resume loop check for none. Failures are returned as values (reactor_expected.hpp), an
+	// exception escaping any coroutine anyway terminates the process.
+	class reactor_no_exceptions : public reactor_error_policy
+	{
+	public:
+		void on_unhandled_exception(const void*)
+		{
+			std::terminate();
+		}
+	};
+
+	namespace detail
+	{
+		// Policies derived from given kind in the order they were listed
+		template <class Kind, class... Policies>
+		struct select_policies
+		{
+			typedef decltype(std::tuple_cat(std::declval<typename std::conditional<std::is_base_of<Kind, Policies>::value,
+				std::tuple<Policies>, std::tuple<> >::type>()...)) type;
+		};
+
+		template <class Tuple>
+		struct queue_type_of
+		{
+			typedef vector_frame_queue type;
+		};
+
+		template <class Queue>
+		struct queue_type_of<std::tuple<Queue> >
+		{
+			typedef typename Queue::queue_type type;
+		};
+
+		// Frame queue selected by the queue policy, vector_frame_queue without one
+		template <class... Policies>
+		struct frame_queue_of
+		{
+			static_assert(std::tuple_size<typename select_policies<reactor_queue_policy, Policies...>::type>::value <= 1,
+				"Scheduler takes a single queue policy");
+
+			typedef typename queue_type_of<typename select_policies<reactor_queue_policy, Policies...>::type>::type type;
+		};
+
+		struct no_frame_node
+		{
+		};
+
+		struct no_coroutine_address
+		{
+		};
+
+		struct no_exception_ptr
+		{
+		};
+
+		template <class Tuple>
+		struct coroutine_data_of;
+
+		template <class... Instrumentation>
+		struct coroutine_data_of<std::tuple<Instrumentation...> >
+		{
+			typedef std::tuple<typename Instrumentation::coroutine_data...> type;
+		};
+
+		template <class P, class Tuple>
+		struct policy_index;
+
+		template <class P, class... Rest>
+		struct policy_index<P, std::tuple<P, Rest...> > : std::integral_constant<std::size_t, 0>
+		{
+		};
+
+		template <class P, class First, class... Rest>
+		struct policy_index<P, std::tuple<First, Rest...> > : std::integral_constant<std::size_t, 1 + policy_index<P, std::tuple<Rest...> >::value>
+		{
+		};
+
+		template <class Data, std::size_t... I, class... Instrumentation>
+		void create_instrumentation(std::tuple<Instrumentation...>*, Data& data, const source_location& location, std::index_sequence<I...>)
+		{
+			(Instrumentation::on_create(std::get<I>(data), location), ...);
+		}
+
+		template <class Instrumentation, class Data, class F, std::size_t... I>
+		void for_each_instrumentation(Instrumentation& instrumentation, Data& data, F&& f, std::index_sequence<I...>)
+		{
+			(f(std::get<I>(instrumentation), std::get<I>(data)), ...);
+		}
+
+		// Name of awaitable kind for instrumentation, awaitables may declare their own
+		template <class A, class = void>
+		struct awaitable_name_of
+		{
+			static constexpr const char* value = "awaitable";
+		};
+
+		template <class A>
+		struct awaitable_name_of<A, std::void_t<decltype(std::remove_reference<A>::type::awaitable_name)> >
+		{
+			static constexpr const char* value = std::remove_reference<A>::type::awaitable_name;
+		};
+
+		// Coroutine frames of promises with a frame allocator policy come from the policy
+		template <class Tuple>
+		class frame_allocation
+		{
+			static_assert(std::tuple_size<Tuple>::value == 0, "Coroutine takes a single frame allocator policy");
+		};
+
+		template <class Allocator>
+		class frame_allocation<std::tuple<Allocator> >
+		{
+		public:
+			static void* operator new(std::size_t size)
+			{
+				return Allocator::allocate_frame(size);
+			}
+
+			static void operator delete(void* frame, std::size_t size) noexcept
+			{
+				Allocator::deallocate_frame(frame, size);
+			}
+		};
+
+		// Locks the threading policy for a scope, nothing without one
+		template <class Tuple>
+		class queue_guard
+		{
+			static_assert(std::tuple_size<Tuple>::value == 0, "Scheduler takes a single threading policy");
+
+		public:
+			explicit queue_guard(Tuple&)
+			{
+			}
+		};
+
+		template <class Threading>
+		class queue_guard<std::tuple<Threading> >
+		{
+		public:
+			explicit queue_guard(std::tuple<Threading>& threading)
+				: m_threading(std::get<0>(threading))
+			{
+				m_threading.lock();
+			}
+
+			queue_guard(const queue_guard&) = delete;
+			queue_guard& operator=(const queue_guard&) = delete;
+
+			~queue_guard()
+			{
+				m_threading.unlock();
+			}
+
+		private:
+			Threading& m_threading;
+		};
+
+		template <class T, class... Policies>
+		class reactor_promise_base;
+
+		template <class T, class... Policies>
+		class coroutine_awaitable;
+
+		template <class R, class T, class... Policies>
+		class coroutine_awaitable_return;
+
+		template <class R, class T, class... Policies>
+		class shared_coroutine_awaitable;
+
+		template <class Y, class T, class... Policies>
+		class generator_next_awaitable;
+
+		// Completed coroutine continues with its awaiter by symmetric transfer, so completion never
+		// resumes the awaiter from inside of its own await_suspend and stack does not grow with nesting
+		class final_awaitable
+		{
+		public:
+			bool await_ready() const noexcept
+			{
+				return false;
+			}
+
+			template <class P>
+			coro::coroutine_handle<> await_suspend(coro::coroutine_handle<P> coroutine) noexcept
+			{
+				auto& promise = coroutine.promise();
+				if constexpr (P::instrumented)
+				{
+					promise.on_await(reactor_instrumentation::completed_awaitable);
+					promise.on_suspend(false);
+				}
+
+				if (promise.m_continuation)
+				{
+					return promise.m_continuation;
+				}
+				return coro::noop_coroutine();
+			}
+
+			void await_resume() const noexcept
+			{
+			}
+		};
+
+		// First resume of an instrumented coroutine
+		template <class P>
+		class initial_awaitable
+		{
+		public:
+			explicit initial_awaitable(P& promise)
+				: m_promise(&promise)
+			{
+			}
+
+			bool await_ready() const noexcept
+			{
+				return false;
+			}
+
+			void await_suspend(coro::coroutine_handle<>) const noexcept
+			{
+			}
+
+			void await_resume() const
+			{
+				m_promise->on_resume(false);
+			}
+
+		private:
+			P* m_promise;
+		};
+
+		// Reports suspension and resumption of awaiting coroutine around any awaitable
+		template <class A, class P>
+		class instrumented_awaitable
+		{
+		public:
+			instrumented_awaitable(A&& awaitable, P& promise, bool child)
+				: m_awaitable(std::forward<A>(awaitable)), m_promise(&promise), m_child(child), m_suspended(false)
+			{
+			}
+
+			bool await_ready()
+			{
+				return m_awaitable.await_ready();
+			}
+
+			template <class H>
+			decltype(auto) await_suspend(H awaitingCoroutine)
+			{
+				m_suspended = true;
+				m_promise->on_await(awaitable_name_of<A>::value);
+				m_promise->on_suspend(m_child);
+				return m_awaitable.await_suspend(awaitingCoroutine);
+			}
+
+			decltype(auto) await_resume()
+			{
+				if (m_suspended)
+				{
+					m_promise->on_resume(m_child);
+				}
+				return m_awaitable.await_resume();
+			}
+
+		private:
+			A m_awaitable;
+			P* m_promise;
+			bool m_child;
+			bool m_suspended;
+		};
+
+		// Scheduler binding, exception and continuation shared by all promise types
+		template <class T, class... Policies>
+		class reactor_promise_base : public frame_allocation<typename select_policies<reactor_frame_allocator, Policies...>::type>
+		{
+		public:
+			typedef reactor_scheduler<T, Policies...> scheduler_type;
+			typedef typename select_policies<reactor_instrumentation, Policies...>::type instrumentation_type;
+
+			static constexpr bool instrumented = std::tuple_size<instrumentation_type>::value != 0;
+			static constexpr bool exceptions = std::tuple_size<typename select_policies<reactor_no_exceptions, Policies...>::type>::value == 0;
+			static constexpr bool error_handled = exceptions && std::tuple_size<typename select_policies<reactor_error_policy, Policies...>::type>::value != 0;
+
+			template <class A>
+			using instrumented_t = typename std::conditional<instrumented, instrumented_awaitable<A, reactor_promise_base>, A>::type;
+
+			explicit reactor_promise_base(const source_location& location)
+				: m_scheduler(nullptr)
+			{
+				if constexpr (instrumented)
+				{
+					create_instrumentation(static_cast<instrumentation_type*>(nullptr), m_instrumentation_data, location,
+						std::make_index_sequence<std::tuple_size<instrumentation_type>::value>());
+				}
+			}
+
+			~reactor_promise_base()
+			{
+				if constexpr (instrumented)
+				{
+					if (m_scheduler)
+					{
+						instrument([](auto& policy, auto& data) { policy.on_destroy(data); });
+					}
+				}
+			}
+
+			typename std::conditional<instrumented, initial_awaitable<reactor_promise_base>, coro::suspend_always>::type initial_suspend()
+			{
+				if constexpr (instrumented)
+				{
+					return initial_awaitable<reactor_promise_base>{ *this };
+				}
+				else
+				{
+					return {};
+				}
+			}
+
+			final_awaitable final_suspend() const noexcept
+			{
+				return {};
+			}
+
+			// Awaited coroutines keep exception for their awaiter, top level ones go to the error policy
+			// of the scheduler or are thrown out of update
+			void unhandled_exception()
+			{
+				if constexpr (!exceptions)
+				{
+					// Nothing keeps the exception, awaiter expects a value
+					std::terminate();
+				}
+				else if (!m_continuation)
+				{
+					if constexpr (error_handled)
+					{
+						std::get<0>(m_scheduler->m_errors).on_unhandled_exception(m_address);
+						return;
+					}
+					else
+					{
+						throw;
+					}
+				}
+				else
+				{
+					m_exception = std::current_exception();
+				}
+			}
+
+			// Awaitables that live outside this header (I/O, mailboxes...) are awaited as they are,
+			// temporaries are moved into coroutine frame so they survive suspension
+			template<typename U>
+			instrumented_t<U> await_transform(U&& value)
+			{
+				// Passed through next_frame would never be given a scheduler
+				static_assert(!is_next_frame<std::remove_cvref_t<U> >::value, "next_frame must be awaited as a temporary with the frame data of the coroutine");
+				return instrument_awaitable<U>(std::forward<U>(value), false);
+			}
+
+			// Written with or without the policies, next_frame{} is bound to scheduler of this coroutine
+			template <class... P>
+			instrumented_t<next_frame<T, Policies...> > await_transform(next_frame<T, P...>&& awaitable);
+			instrumented_t<coroutine_awaitable<T, Policies...> > await_transform(reactor_coroutine<T, Policies...>&& awaitable);
+
+			template <class U>
+			instrumented_t<coroutine_awaitable_return<U, T, Policies...> > await_transform(reactor_coroutine_return<U, T, Policies...>&& awaitable);
+
+			template <class U>
+			instrumented_t<shared_coroutine_awaitable<U, T, Policies...> > await_transform(reactor_shared_coroutine_return<U, T, Policies...>& awaitable);
+
+			template <class U>
+			instrumented_t<shared_coroutine_awaitable<U, T, Policies...> > await_transform(reactor_shared_coroutine_return<U, T, Policies...>&& awaitable);
+
+			template <class Y>
+			instrumented_t<generator_next_awaitable<Y, T, Policies...> > await_transform(generator_next_awaitable<Y, T, Policies...>&& awaitable);
+
+			void rethrow_if_exception()
+			{
+				if constexpr (exceptions)
+				{
+					if (m_exception)
+					{
+						std::rethrow_exception(m_exception);
+					}
+				}
+			}
 
-namespace cppcoro
-{
-	struct reactor_default_frame_data
-	{
-	};
+			void on_resume(bool child)
+			{
+				instrument([child](auto& policy, auto& data) { policy.on_resume(data, child); });
+			}
 
-	template <class T = reactor_default_frame_data>
-	class reactor_scheduler;
+			void on_suspend(bool child)
+			{
+				instrument([child](auto& policy, auto& data) { policy.on_suspend(data, child); });
+			}
 
-	template <class T = reactor_default_frame_data>
-	class reactor_coroutine;
+			void on_await(const char* awaitable)
+			{
+				instrument([awaitable](auto& policy, auto& data) { policy.on_await(data, awaitable); });
+			}
 
-	template <class R, class T = reactor_default_frame_data>
-	class reactor_coroutine_return;
+			template <class Instrumentation>
+			const typename Instrumentation::coroutine_data& instrumentation_data() const
+			{
+				return std::get<policy_index<Instrumentation, instrumentation_type>::value>(m_instrumentation_data);
+			}
 
-	template <class T = reactor_default_frame_data>
-	class next_frame;
+		private:
+			friend class final_awaitable;
+			friend class reactor_coroutine<T, Policies...>;
+			friend class reactor_scheduler<T, Policies...>;
+			friend class coroutine_awaitable<T, Policies...>;
 
+			template <class R, class U, class... Ps>
+			friend class cppcoro::reactor_coroutine_return;
 
-	namespace detail
-	{
-		template <class T>
-		class coroutine_awaitable;
+			template <class R, class U, class... Ps>
+			friend class coroutine_awaitable_return;
 
-		template <class R, class T>
-		class coroutine_awaitable_return;
+			template <class R, class U, class... Ps>
+			friend class cppcoro::reactor_shared_coroutine_return;
 
-		template <class T = reactor_default_frame_data>
-		class reactor_coroutine_promise
-		{
-		public:
-			reactor_coroutine_promise()
-				: m_awaiter(nullptr), m_scheduler(nullptr)
+			template <class R, class U, class... Ps>
+			friend class reactor_shared_coroutine_promise;
+
+			template <class R, class U, class... Ps>
+			friend class shared_coroutine_awaitable;
+
+			template <class Y, class U, class... Ps>
+			friend class reactor_generator_promise;
+
+			template <class Y, class U, class... Ps>
+			friend class generator_next_awaitable;
+
+			template <class A>
+			instrumented_t<A> instrument_awaitable(A&& awaitable, bool child)
 			{
+				if constexpr (instrumented)
+				{
+					return { std::forward<A>(awaitable), *this, child };
+				}
+				else
+				{
+					return std::forward<A>(awaitable);
+				}
 			}
 
-			reactor_coroutine<T> get_return_object() noexcept;
-
-			constexpr std::experimental::suspend_always initial_suspend() const
+			template <class F>
+			void instrument(F&& f)
 			{
-				return {};
+				for_each_instrumentation(m_scheduler->m_instrumentation, m_instrumentation_data, f,
+					std::make_index_sequence<std::tuple_size<instrumentation_type>::value>());
 			}
-			constexpr std::experimental::suspend_always final_suspend() const
+
+			void schedule(scheduler_type& scheduler, const void* address)
 			{
-				return {};
+				// False means that coroutine was already scheduled by something else, not permited in this model due to efficiency
+				assert(m_scheduler == nullptr);
+				m_scheduler = &scheduler;
+				if constexpr (error_handled)
+				{
+					m_address = address;
+				}
+
+				instrument([address](auto& policy, auto& data) { policy.on_schedule(data, address); });
 			}
 
+			scheduler_type* m_scheduler;
+			REACTOR_NO_UNIQUE_ADDRESS typename std::conditional<exceptions, std::exception_ptr, no_exception_ptr>::type m_exception;
+			coro::coroutine_handle<> m_continuation;
 
-			void unhandled_exception()
+			// Queues pushed coroutine for its first resume, only intrusive queues need it
+			REACTOR_NO_UNIQUE_ADDRESS typename std::conditional<frame_queue_of<Policies...>::type::intrusive,
+				reactor_frame_node, no_frame_node>::type m_frame_node;
+			// Reported to the error policy, only kept with one
+			REACTOR_NO_UNIQUE_ADDRESS typename std::conditional<error_handled, const void*, no_coroutine_address>::type m_address;
+			REACTOR_NO_UNIQUE_ADDRESS typename coroutine_data_of<instrumentation_type>::type m_instrumentation_data;
+		};
+
+		template <class T = reactor_default_frame_data, class... Policies>
+		class reactor_coroutine_promise : public reactor_promise_base<T, Policies...>
+		{
+		public:
+			// Default argument is evaluated in the coroutine, so it names the coroutine function
+			reactor_coroutine_promise(source_location location = source_location::current())
+				: reactor_promise_base<T, Policies...>(location)
 			{
-				m_exception = std::current_exception();
 			}
 
+			reactor_coroutine<T, Policies...> get_return_object() noexcept;
+
 			void return_void()
 			{
-				if (m_awaiter)
+			}
+		};
+
+		// Returned value is constructed in place by co_return and moved out to the awaiter once,
+		// R does not need a default constructor and may be move-only
+		template <class R>
+		class return_value_storage
+		{
+		public:
+			return_value_storage()
+				: m_has_value(false)
+			{
+			}
+
+			return_value_storage(const return_value_storage&) = delete;
+			return_value_storage& operator=(const return_value_storage&) = delete;
+
+			~return_value_storage()
+			{
+				if (m_has_value)
 				{
-					m_awaiter->m_awaitingCoroutine.resume();
-					m_awaiter = nullptr;
+					m_value.~R();
 				}
-				return;
 			}
 
-			template<typename U>
-			std::experimental::suspend_always await_transform(U&& value)
+			void return_value(const R& value)
 			{
-				return value;
+				assert(!m_has_value);
+				new (&m_value) R(value);
+				m_has_value = true;
 			}
 
-			next_frame<T> await_transform(next_frame<T>&& awaitable);
-			coroutine_awaitable<T> await_transform(reactor_coroutine<T>&& awaitable);
+			void return_value(R&& value)
+			{
+				assert(!m_has_value);
+				new (&m_value) R(std::move(value));
+				m_has_value = true;
+			}
 
-			template <typename U>
-			coroutine_awaitable_return<U, T> await_transform(reactor_coroutine_return<U, T>&& awaitable);
+			R take_value()
+			{
+				assert(m_has_value);
+				return std::move(m_value);
+			}
 
-			void rethrow_if_exception()
+			R& value()
 			{
-				if (m_exception)
-				{
-					std::rethrow_exception(m_exception);
-				}
+				assert(m_has_value);
+				return m_value;
 			}
 
 		private:
-			friend class reactor_coroutine<T>;
-			friend class coroutine_awaitable<T>;
-			
-			reactor_scheduler<T>* m_scheduler;
-			std::exception_ptr m_exception;
-			coroutine_awaitable<T>* m_awaiter;
+			union
+			{
+				R m_value;
+			};
+			bool m_has_value;
 		};
 
-		template <class R, class T = reactor_default_frame_data>
-		class reactor_coroutine_promise_return
+		// Reference is returned as it is, referenced object has to outlive the awaiter
+		template <class R>
+		class return_value_storage<R&>
 		{
 		public:
-			reactor_coroutine_promise_return()
-				: m_awaiter(nullptr), m_scheduler(nullptr)
+			return_value_storage()
+				: m_value(nullptr)
 			{
 			}
 
-			reactor_coroutine_return<R, T> get_return_object() noexcept;
+			void return_value(R& value)
+			{
+				m_value = &value;
+			}
 
-			constexpr std::experimental::suspend_always initial_suspend() const
+			R& take_value()
 			{
-				return {};
+				assert(m_value);
+				return *m_value;
 			}
-			constexpr std::experimental::suspend_always final_suspend() const
+
+			R& value()
 			{
-				return {};
+				return take_value();
 			}
 
-			void unhandled_exception()
+		private:
+			R* m_value;
+		};
+
+		template <class R, class T = reactor_default_frame_data, class... Policies>
+		class reactor_coroutine_promise_return : public reactor_promise_base<T, Policies...>, public return_value_storage<R>
+		{
+		public:
+			reactor_coroutine_promise_return(source_location location = source_location::current())
+				: reactor_promise_base<T, Policies...>(location)
+			{
+			}
+
+			reactor_coroutine_return<R, T, Policies...> get_return_object() noexcept;
+		};
+
+		// Shared coroutine starts when first awaited and completes once for all of its awaiters,
+		// which wait in a list of nodes kept in their own frames
+		template <class R, class T = reactor_default_frame_data, class... Policies>
+		class reactor_shared_coroutine_promise : public reactor_promise_base<T, Policies...>, public return_value_storage<R>
+		{
+		public:
+			reactor_shared_coroutine_promise(source_location location = source_location::current())
+				: reactor_promise_base<T, Policies...>(location), m_references(0)
+			{
+			}
+
+			reactor_shared_coroutine_return<R, T, Policies...> get_return_object() noexcept;
+
+			// All awaiters are resumed together in the next frame
+			class final_awaitable
+			{
+			public:
+				bool await_ready() const noexcept
+				{
+					return false;
+				}
+
+				void await_suspend(coro::coroutine_handle<reactor_shared_coroutine_promise> coroutine) noexcept
+				{
+					auto& promise = coroutine.promise();
+					if constexpr (reactor_promise_base<T, Policies...>::instrumented)
+					{
+						promise.on_await(reactor_instrumentation::completed_awaitable);
+						promise.on_suspend(false);
+					}
+
+					if (!promise.m_waiters.empty())
+					{
+						promise.m_scheduler->enqueue_update(promise.m_waiters, "shared_coroutine");
+					}
+				}
+
+				void await_resume() const noexcept
+				{
+				}
+			};
+
+			final_awaitable final_suspend() const noexcept
 			{
-				m_exception = std::current_exception();
+				return {};
 			}
 
-			void return_value(R value)
+			// Exception is kept for every awaiter, there is no single one to rethrow it to
+			void unhandled_exception()
 			{
-				m_value = value;
-				if (m_awaiter)
+				if constexpr (reactor_promise_base<T, Policies...>::exceptions)
+				{
+					this->m_exception = std::current_exception();
+				}
+				else
 				{
-					m_awaiter->m_awaitingCoroutine.resume();
-					m_awaiter = nullptr;
+					std::terminate();
 				}
 			}
 
-			R get_value()
+		private:
+			friend class reactor_shared_coroutine_return<R, T, Policies...>;
+			friend class shared_coroutine_awaitable<R, T, Policies...>;
+
+			std::size_t m_references;
+			reactor_frame_list m_waiters;
+		};
+
+		// Generator runs only while its consumer awaits next(), co_yield hands the value over to the
+		// consumer by symmetric transfer and completion returns to it through final_awaitable
+		template <class Y, class T = reactor_default_frame_data, class... Policies>
+		class reactor_generator_promise : public reactor_promise_base<T, Policies...>
+		{
+		public:
+			reactor_generator_promise(source_location location = source_location::current())
+				: reactor_promise_base<T, Policies...>(location), m_yielded(nullptr)
 			{
-				return m_value;
 			}
 
-			template<typename U>
-			std::experimental::suspend_always await_transform(U&& value)
+			reactor_generator<Y, T, Policies...> get_return_object() noexcept;
+
+			void return_void()
 			{
-				return value;
 			}
 
-			next_frame<T> await_transform(next_frame<T>&& awaitable);
-			coroutine_awaitable<T> await_transform(reactor_coroutine<T>&& awaitable);
+			// Yielded value stays in the generator frame until the consumer asks for the next one
+			class yield_awaitable
+			{
+			public:
+				static constexpr const char* awaitable_name = "yield";
 
-			template <class U>
-			coroutine_awaitable_return<U, T> await_transform(reactor_coroutine_return<U, T>&& awaitable);
+				explicit yield_awaitable(Y* value)
+					: m_value(value)
+				{
+				}
 
-			void rethrow_if_exception()
+				bool await_ready() const noexcept
+				{
+					return false;
+				}
+
+				coro::coroutine_handle<> await_suspend(coro::coroutine_handle<reactor_generator_promise> generator) noexcept
+				{
+					auto& promise = generator.promise();
+					assert(promise.m_continuation);
+					promise.m_yielded = m_value;
+
+					auto consumer = promise.m_continuation;
+					promise.m_continuation = nullptr;
+					return consumer;
+				}
+
+				void await_resume() const noexcept
+				{
+				}
+
+			protected:
+				Y* m_value;
+			};
+
+			// Lvalue is copied into the awaitable, so the consumer may move from it
+			class yield_copy_awaitable : public yield_awaitable
 			{
-				if (m_exception)
+			public:
+				explicit yield_copy_awaitable(const Y& value)
+					: yield_awaitable(nullptr), m_copy(value)
+				{
+				}
+
+				coro::coroutine_handle<> await_suspend(coro::coroutine_handle<reactor_generator_promise> generator) noexcept
 				{
-					std::rethrow_exception(m_exception);
+					this->m_value = &m_copy;
+					return yield_awaitable::await_suspend(generator);
 				}
+
+			private:
+				Y m_copy;
+			};
+
+			auto yield_value(Y&& value)
+			{
+				return this->instrument_awaitable(yield_awaitable{ std::addressof(value) }, false);
+			}
+
+			auto yield_value(const Y& value)
+			{
+				return this->instrument_awaitable(yield_copy_awaitable{ value }, false);
 			}
 
 		private:
-			friend class reactor_coroutine_return<R, T>;
-			friend class coroutine_awaitable_return<R, T>;
+			friend class generator_next_awaitable<Y, T, Policies...>;
 
-			reactor_scheduler<T>* m_scheduler;
-			std::exception_ptr m_exception;
-			R m_value;
-			coroutine_awaitable_return<R, T>* m_awaiter;
+			Y* m_yielded;
 		};
 	}
 
 
-	template <class T>
+	template <class T, class... Policies>
 	class reactor_coroutine
 	{
 	public:
 
-		using promise_type = detail::reactor_coroutine_promise<T>;
+		using promise_type = detail::reactor_coroutine_promise<T, Policies...>;
 
 		reactor_coroutine() noexcept
 			: m_coroutine(nullptr)
@@ -189,6 +1378,15 @@ namespace cppcoro
 
 		reactor_coroutine(const reactor_coroutine& other) = delete;
 
+		// Releases coroutine frame, coroutine must not be suspended in a scheduler anymore
+		~reactor_coroutine()
+		{
+			if (m_coroutine)
+			{
+				m_coroutine.destroy();
+			}
+		}
+
 		reactor_coroutine& operator=(reactor_coroutine other) noexcept
 		{
 			swap(other);
@@ -200,50 +1398,43 @@ namespace cppcoro
 			std::swap(m_coroutine, other.m_coroutine);
 		}
 
+		// Empty or finished, frame is still owned until destruction
+		bool done() const noexcept
+		{
+			return !m_coroutine || m_coroutine.done();
+		}
+
+		// Per-coroutine state of an instrumentation policy, coroutine must not be empty
+		template <class Instrumentation>
+		const typename Instrumentation::coroutine_data& instrumentation_data() const
+		{
+			return m_coroutine.promise().template instrumentation_data<Instrumentation>();
+		}
+
 	private:
 
-		friend class detail::reactor_coroutine_promise<T>;
-		friend class detail::coroutine_awaitable<T>;
-		friend class reactor_scheduler<T>;
+		friend class detail::reactor_coroutine_promise<T, Policies...>;
+		friend class detail::coroutine_awaitable<T, Policies...>;
+		friend class reactor_scheduler<T, Policies...>;
 
-		explicit reactor_coroutine(std::experimental::coroutine_handle<promise_type> coroutine) noexcept
+		explicit reactor_coroutine(detail::coro::coroutine_handle<promise_type> coroutine) noexcept
 			: m_coroutine(coroutine)
 		{}
 
-		void schedule(reactor_scheduler<T>& scheduler)
-		{
-			auto& p = m_coroutine.promise();
-
-			// False means that coroutine was already scheduled by something else, not permited in this model due to efficiency
-			assert(p.m_scheduler == nullptr); 
-			p.m_scheduler = &scheduler;
-		}
-
-		bool update_next_frame()
+		void schedule(reactor_scheduler<T, Policies...>& scheduler)
 		{
-			if (m_coroutine)
-			{
-				m_coroutine.resume();
-				if (!m_coroutine.done())
-				{
-					return true;
-				}
-
-				m_coroutine.promise().rethrow_if_exception();
-			}
-
-			return false;
+			m_coroutine.promise().schedule(scheduler, m_coroutine.address());
 		}
 
-		std::experimental::coroutine_handle<promise_type> m_coroutine;
+		detail::coro::coroutine_handle<promise_type> m_coroutine;
 	};
 
-	template <class R, class T>
+	template <class R, class T, class... Policies>
 	class reactor_coroutine_return
 	{
 	public:
 
-		using promise_type = detail::reactor_coroutine_promise_return<R, T>;
+		using promise_type = detail::reactor_coroutine_promise_return<R, T, Policies...>;
 
 		reactor_coroutine_return() noexcept
 			: m_coroutine(nullptr)
@@ -257,6 +1448,14 @@ namespace cppcoro
 
 		reactor_coroutine_return(const reactor_coroutine_return& other) = delete;
 
+		~reactor_coroutine_return()
+		{
+			if (m_coroutine)
+			{
+				m_coroutine.destroy();
+			}
+		}
+
 		reactor_coroutine_return& operator=(reactor_coroutine_return other) noexcept
 		{
 			swap(other);
@@ -268,49 +1467,212 @@ namespace cppcoro
 			std::swap(m_coroutine, other.m_coroutine);
 		}
 
+		// Empty or finished, frame is still owned until destruction
+		bool done() const noexcept
+		{
+			return !m_coroutine || m_coroutine.done();
+		}
+
+		// Per-coroutine state of an instrumentation policy, coroutine must not be empty
+		template <class Instrumentation>
+		const typename Instrumentation::coroutine_data& instrumentation_data() const
+		{
+			return m_coroutine.promise().template instrumentation_data<Instrumentation>();
+		}
+
 	private:
 
-		friend class detail::reactor_coroutine_promise_return<R, T>;
-		friend class detail::coroutine_awaitable_return<R, T>;
+		friend class detail::reactor_coroutine_promise_return<R, T, Policies...>;
+		friend class detail::coroutine_awaitable_return<R, T, Policies...>;
 
-		explicit reactor_coroutine_return(std::experimental::coroutine_handle<promise_type> coroutine) noexcept
+		explicit reactor_coroutine_return(detail::coro::coroutine_handle<promise_type> coroutine) noexcept
 			: m_coroutine(coroutine)
 		{}
 
-		void schedule(reactor_scheduler<T>& scheduler)
+		void schedule(reactor_scheduler<T, Policies...>& scheduler)
 		{
-			auto& p = m_coroutine.promise();
+			m_coroutine.promise().schedule(scheduler, m_coroutine.address());
+		}
+
+		detail::coro::coroutine_handle<promise_type> m_coroutine;
+	};
+
+	// Coroutine computing a value once for any number of awaiters. It starts when first awaited,
+	// awaiters arriving while it runs wait for it and are all resumed in the frame after it
+	// completes, later ones get the value right away. Copies share the coroutine, its frame is
+	// released with the last copy:
+	//
+	//   reactor_shared_coroutine_return<path> route = find_route(from, to);
+	//   const path& p = co_await route; // In every coroutine that needs it
+	//
+	// Awaiters get a reference to the value kept in the frame, it is valid while a copy lives.
+	// All awaiters have to run on the same scheduler.
+	template <class R, class T, class... Policies>
+	class reactor_shared_coroutine_return
+	{
+	public:
+
+		using promise_type = detail::reactor_shared_coroutine_promise<R, T, Policies...>;
+
+		reactor_shared_coroutine_return() noexcept
+			: m_coroutine(nullptr)
+		{}
 
-			// False means that coroutine was already scheduled by something else, not permited in this model due to efficiency
-			assert(p.m_scheduler == nullptr);
-			p.m_scheduler = &scheduler;
+		reactor_shared_coroutine_return(reactor_shared_coroutine_return&& other) noexcept
+			: m_coroutine(other.m_coroutine)
+		{
+			other.m_coroutine = nullptr;
 		}
 
-		bool update_next_frame()
+		reactor_shared_coroutine_return(const reactor_shared_coroutine_return& other) noexcept
+			: m_coroutine(other.m_coroutine)
 		{
 			if (m_coroutine)
 			{
-				m_coroutine.resume();
-				if (!m_coroutine.done())
-				{
-					return true;
-				}
+				m_coroutine.promise().m_references++;
+			}
+		}
+
+		~reactor_shared_coroutine_return()
+		{
+			if (m_coroutine && --m_coroutine.promise().m_references == 0)
+			{
+				m_coroutine.destroy();
+			}
+		}
+
+		reactor_shared_coroutine_return& operator=(reactor_shared_coroutine_return other) noexcept
+		{
+			swap(other);
+			return *this;
+		}
+
+		void swap(reactor_shared_coroutine_return& other) noexcept
+		{
+			std::swap(m_coroutine, other.m_coroutine);
+		}
+
+		// Empty or finished, a finished one gives its value to awaiters without suspending them
+		bool done() const noexcept
+		{
+			return !m_coroutine || m_coroutine.done();
+		}
+
+		// Per-coroutine state of an instrumentation policy, coroutine must not be empty
+		template <class Instrumentation>
+		const typename Instrumentation::coroutine_data& instrumentation_data() const
+		{
+			return m_coroutine.promise().template instrumentation_data<Instrumentation>();
+		}
+
+	private:
+
+		friend class detail::reactor_promise_base<T, Policies...>;
+		friend class detail::reactor_shared_coroutine_promise<R, T, Policies...>;
+		friend class detail::shared_coroutine_awaitable<R, T, Policies...>;
+
+		explicit reactor_shared_coroutine_return(detail::coro::coroutine_handle<promise_type> coroutine) noexcept
+			: m_coroutine(coroutine)
+		{
+			m_coroutine.promise().m_references++;
+		}
 
-				m_coroutine.promise().rethrow_if_exception();
+		detail::coro::coroutine_handle<promise_type> m_coroutine;
+	};
+
+	// Coroutine producing a sequence of values for one consumer coroutine. Generator starts when the
+	// consumer first awaits next() and runs until its next co_yield, which resumes the consumer in
+	// the same frame. In between it may await next_frame or other coroutines, so a sequence can be
+	// spread over frames:
+	//
+	//   reactor_generator<row> query(table& t)
+	//   {
+	//      for (auto& r : t) { co_yield r; co_await next_frame{}; }
+	//   }
+	//
+	//   auto rows = query(t);
+	//   while (row* r = co_await rows.next()) { ... }
+	//
+	// next() returns a pointer to the value in the generator frame, valid until the next call, and
+	// null once the generator completes. Values are not collected anywhere.
+	template <class Y, class T, class... Policies>
+	class reactor_generator
+	{
+	public:
+
+		using promise_type = detail::reactor_generator_promise<Y, T, Policies...>;
+
+		reactor_generator() noexcept
+			: m_coroutine(nullptr)
+		{}
+
+		reactor_generator(reactor_generator&& other) noexcept
+			: m_coroutine(other.m_coroutine)
+		{
+			other.m_coroutine = nullptr;
+		}
+
+		reactor_generator(const reactor_generator& other) = delete;
+
+		~reactor_generator()
+		{
+			if (m_coroutine)
+			{
+				m_coroutine.destroy();
 			}
+		}
+
+		reactor_generator& operator=(reactor_generator other) noexcept
+		{
+			swap(other);
+			return *this;
+		}
+
+		void swap(reactor_generator& other) noexcept
+		{
+			std::swap(m_coroutine, other.m_coroutine);
+		}
+
+		// Empty or finished, next() gives null without suspending
+		bool done() const noexcept
+		{
+			return !m_coroutine || m_coroutine.done();
+		}
+
+		// Awaitable resuming the generator until it yields the next value or completes
+		detail::generator_next_awaitable<Y, T, Policies...> next() noexcept
+		{
+			return detail::generator_next_awaitable<Y, T, Policies...>{ *this };
+		}
 
-			return false;
+		// Per-coroutine state of an instrumentation policy, coroutine must not be empty
+		template <class Instrumentation>
+		const typename Instrumentation::coroutine_data& instrumentation_data() const
+		{
+			return m_coroutine.promise().template instrumentation_data<Instrumentation>();
 		}
 
-		std::experimental::coroutine_handle<promise_type> m_coroutine;
+	private:
+
+		friend class detail::reactor_generator_promise<Y, T, Policies...>;
+		friend class detail::generator_next_awaitable<Y, T, Policies...>;
+		friend class detail::reactor_promise_base<T, Policies...>;
+
+		explicit reactor_generator(detail::coro::coroutine_handle<promise_type> coroutine) noexcept
+			: m_coroutine(coroutine)
+		{}
+
+		detail::coro::coroutine_handle<promise_type> m_coroutine;
 	};
 
 	namespace detail
 	{
-		template <class T>
+		// Frame data as the scheduler keeps it between update_next_frame and the awaiters reading it
+		template <class T, bool Empty = std::is_empty<T>::value && std::is_trivially_default_constructible<T>::value>
 		struct reference_to_pointer
 		{
-			typedef typename T value;
+			typedef T value;
+			static constexpr bool empty = false;
 
 			value m_value;
 
@@ -318,7 +1680,7 @@ namespace cppcoro
 			{
 				return m_value;
 			}
-			
+
 			void set(T v)
 			{
 				m_value = v;
@@ -326,9 +1688,10 @@ namespace cppcoro
 		};
 
 		template <class T>
-		struct reference_to_pointer<T&>
+		struct reference_to_pointer<T&, false>
 		{
-			typedef typename T* value;
+			typedef T* value;
+			static constexpr bool empty = false;
 
 			value m_value;
 
@@ -342,59 +1705,258 @@ namespace cppcoro
 				m_value = &v;
 			}
 		};
+
+		// Empty frame data like reactor_default_frame_data is not stored, every awaiter gets a new one
+		template <class T>
+		struct reference_to_pointer<T, true>
+		{
+			static constexpr bool empty = true;
+
+			static constexpr T get()
+			{
+				return T();
+			}
+
+			static constexpr void set(const T&)
+			{
+			}
+		};
 	}
 
-	template <class T>
+	// Services that need to run around every frame of a scheduler (I/O submission, cross thread links...)
+	class reactor_frame_hook
+	{
+	public:
+		// Called before any coroutine is resumed, handles enqueued here are resumed in the same frame
+		virtual void begin_frame() {}
+
+		// Called after all coroutines of the frame were resumed and started
+		virtual void end_frame() {}
+
+	protected:
+		reactor_frame_hook()
+			: m_next_hook(nullptr)
+		{
+		}
+
+		~reactor_frame_hook() = default;
+
+	private:
+		template <class T, class... Policies>
+		friend class reactor_scheduler;
+
+		reactor_frame_hook* m_next_hook;
+	};
+
+	template <class T, class... Policies>
 	class reactor_scheduler
 	{
 	public:
+		typedef typename detail::select_policies<reactor_instrumentation, Policies...>::type instrumentation_type;
+		typedef typename detail::select_policies<reactor_fixed_capacity, Policies...>::type capacity_type;
+		typedef typename detail::select_policies<reactor_threading_policy, Policies...>::type threading_type;
+		typedef typename detail::select_policies<reactor_error_policy, Policies...>::type error_type;
+
+		typedef typename detail::frame_queue_of<Policies...>::type queue_type;
+
+		static constexpr bool fixed_capacity = std::tuple_size<capacity_type>::value != 0;
+		static constexpr bool intrusive_queue = queue_type::intrusive;
+		static constexpr bool exceptions = std::tuple_size<typename detail::select_policies<reactor_no_exceptions, Policies...>::type>::value == 0;
+		static_assert(std::tuple_size<capacity_type>::value <= 1, "Scheduler takes a single fixed capacity policy");
+		static_assert(std::tuple_size<error_type>::value <= 1, "Scheduler takes a single error policy");
+
+		reactor_scheduler()
+			: m_hooks(nullptr), m_prefetch_distance(8)
+		{
+		}
+
 		void update_next_frame(T reactor_default_frame_data = T())
-		{		
+		{
 			// Sets current frame data, members with access can return it
 			m_reactor_default_frame_data.set(reactor_default_frame_data);
 
-			m_frames.swap();
+			std::apply([](auto&... instrumentation) { (instrumentation.begin_frame(), ...); }, m_instrumentation);
+			std::apply([](auto&... errors) { (errors.begin_frame(), ...); }, m_errors);
+
+			for (auto hook = m_hooks; hook; hook = hook->m_next_hook)
+			{
+				hook->begin_frame();
+			}
 
-			for (auto& handle : m_frames.front())
 			{
-				handle.resume();
+				// Instrumentation swaps what on_enqueue recorded, other threads enqueue under the same guard
+				detail::queue_guard<threading_type> guard(m_threading);
+				m_frames.swap();
+				auto queued = m_frames.front().size();
+				std::apply([queued](auto&... instrumentation) { (instrumentation.on_frame_queue(queued), ...); }, m_instrumentation);
 			}
 
-			m_frames.front().clear();
+			// Pushed coroutines are started from the same list as they have not run yet
+			auto& frame = m_frames.front();
 
-			// We start all coroutines right after updates
-			m_start_coroutines.swap();
+			if constexpr (intrusive_queue)
+			{
+				resume_nodes(frame);
+			}
+			else
+			{
+				frame.group();
+				resume_handles(frame);
+			}
 
-			for (auto& start_coroutine : m_start_coroutines.front())
+			for (auto hook = m_hooks; hook; hook = hook->m_next_hook)
 			{
-				start_coroutine->update_next_frame();
+				hook->end_frame();
 			}
-			m_start_coroutines.front().clear();
+
+			std::apply([](auto&... instrumentation) { (instrumentation.end_frame(), ...); }, m_instrumentation);
 		}
 
-		void push(reactor_coroutine<T>& coroutine)
+		// Coroutine starts in the next update, object has to stay alive until coroutine completes
+		void push(reactor_coroutine<T, Policies...>& coroutine)
 		{
 			coroutine.schedule(*this);
-			m_start_coroutines.back().push_back(&coroutine);
+			if constexpr (intrusive_queue)
+			{
+				auto& node = coroutine.m_coroutine.promise().m_frame_node;
+				node.m_handle = coroutine.m_coroutine;
+				enqueue_update(node, "push");
+			}
+			else
+			{
+				enqueue_update(coroutine.m_coroutine, "push");
+			}
 		}
 
-	private:
-		friend class next_frame<T>;
-		friend class detail::coroutine_awaitable<T>;
+		// Resumes suspended handle in the next update, used by awaitables that live outside this header.
+		// Source names the awaitable kind for instrumentation, it has to outlive the scheduler.
+		void enqueue_update(detail::coro::coroutine_handle<> handle, const char* source = "enqueue_update")
+		{
+			static_assert(!intrusive_queue, "Intrusive queue takes handles with their reactor_frame_node");
+			detail::queue_guard<threading_type> guard(m_threading);
+			admit(source);
+			m_frames.back().push(handle);
+		}
+
+		// Same for a node with the handle set, node has to stay in place until the handle is resumed
+		void enqueue_update(reactor_frame_node& node, const char* source = "enqueue_update")
+		{
+			detail::queue_guard<threading_type> guard(m_threading);
+			admit(source);
+			m_frames.back().push(node);
+		}
+
+		// Queues every node of the list, a single splice with reactor_intrusive_queue. List is left empty.
+		void enqueue_update(reactor_frame_list& nodes, const char* source = "enqueue_update")
+		{
+			if constexpr (intrusive_queue && std::tuple_size<instrumentation_type>::value == 0)
+			{
+				detail::queue_guard<threading_type> guard(m_threading);
+				m_frames.back().push(nodes);
+			}
+			else
+			{
+				for (auto node = nodes.m_first; node;)
+				{
+					auto next = node->m_next;
+					enqueue_update(*node, source);
+					node = next;
+				}
+				nodes.clear();
+			}
+		}
+
+		// Frames of handles this many positions ahead are prefetched while resuming, 0 turns it off
+		void set_prefetch_distance(std::size_t distance)
+		{
+			m_prefetch_distance = distance;
+		}
+
+		// Preallocates both frame queues, with a fixed capacity policy this is their capacity for good
+		void reserve(std::size_t handles)
+		{
+			m_frames.front().reserve(handles);
+			m_frames.back().reserve(handles);
+		}
+
+		void attach(reactor_frame_hook& hook)
+		{
+			assert(hook.m_next_hook == nullptr);
+			hook.m_next_hook = m_hooks;
+			m_hooks = &hook;
+		}
+
+		void detach(reactor_frame_hook& hook)
+		{
+			for (auto link = &m_hooks; *link; link = &(*link)->m_next_hook)
+			{
+				if (*link == &hook)
+				{
+					*link = hook.m_next_hook;
+					hook.m_next_hook = nullptr;
+					return;
+				}
+			}
+		}
+
+		// State of an instrumentation policy the scheduler was created with
+		template <class Instrumentation>
+		Instrumentation& instrumentation()
+		{
+			return std::get<Instrumentation>(m_instrumentation);
+		}
+
+		// Live coroutines using most resume time, only with the reactor_stats policy
+		template <class Stats = reactor_stats>
+			requires (std::is_same<Stats, Policies>::value || ...)
+		auto stats(std::size_t top = 10)
+		{
+			return instrumentation<Stats>().snapshot(top);
+		}
+
+		// Writes every live coroutine with its awaiter chain, only with the reactor_backtrace policy
+		template <class Backtrace = reactor_backtrace, class Stream>
+			requires (std::is_same<Backtrace, Policies>::value || ...)
+		void dump(Stream& out)
+		{
+			instrumentation<Backtrace>().dump(out);
+		}
 
-		void enqueue_update(std::experimental::coroutine_handle<> handle)
+		// State of any policy the scheduler keeps, looked up by its kind
+		template <class Policy>
+		Policy& policy()
 		{
-			m_frames.back().push_back(handle);
+			if constexpr (std::is_base_of<reactor_instrumentation, Policy>::value)
+			{
+				return std::get<Policy>(m_instrumentation);
+			}
+			else if constexpr (std::is_base_of<reactor_fixed_capacity, Policy>::value)
+			{
+				return std::get<Policy>(m_capacity);
+			}
+			else if constexpr (std::is_base_of<reactor_threading_policy, Policy>::value)
+			{
+				return std::get<Policy>(m_threading);
+			}
+			else
+			{
+				static_assert(std::is_base_of<reactor_error_policy, Policy>::value, "Policy has no state in the scheduler");
+				return std::get<Policy>(m_errors);
+			}
 		}
 
+	private:
+		friend class next_frame<T, Policies...>;
+		friend class detail::reactor_promise_base<T, Policies...>;
+
 		template <class D>
 		struct double_buffer
 		{
-			std::vector<D>* m_front;
-			std::vector<D>* m_back;
+			D* m_front;
+			D* m_back;
 
-			std::vector<D> m_next_frame1;
-			std::vector<D> m_next_frame2;
+			D m_next_frame1;
+			D m_next_frame2;
 
 			double_buffer()
 			{
@@ -402,12 +1964,12 @@ namespace cppcoro
 				m_back = &m_next_frame2;
 			}
 
-			std::vector<D>& front()
+			D& front()
 			{
 				return *m_front;
 			}
 
-			std::vector<D>& back()
+			D& back()
 			{
 				return *m_back;
 			}
@@ -418,17 +1980,156 @@ namespace cppcoro
 			}
 		};
 
-		double_buffer<std::experimental::coroutine_handle<> > m_frames;
-		double_buffer<reactor_coroutine<T>*> m_start_coroutines;
-		
-		detail::reference_to_pointer<T> m_reactor_default_frame_data;
+		// Fixed capacity does not survive handles over capacity of the array queue, intrusive queue has no limit
+		void admit(const char* source)
+		{
+			if constexpr (fixed_capacity && !intrusive_queue)
+			{
+				overflow_if_full(source);
+			}
+
+			std::apply([source](auto&... instrumentation) { (instrumentation.on_enqueue(source), ...); }, m_instrumentation);
+		}
+
+		// Dropping the handle would leave its coroutine suspended for good
+		void overflow_if_full(const char* source)
+		{
+			auto& back = m_frames.back();
+			if (back.size() == back.capacity())
+			{
+				std::get<0>(m_capacity).on_queue_overflow(source);
+				std::terminate();
+			}
+		}
+
+		void resume_handles(queue_type& frame)
+		{
+			std::size_t resumed = 0;
+			if constexpr (exceptions)
+			{
+				try
+				{
+					resume_handle_range(frame, resumed);
+				}
+				catch (...)
+				{
+					// Throwing resume still ends, instrumentation would keep it running otherwise
+					std::apply([&frame, resumed](auto&... instrumentation) { (instrumentation.after_resume(frame.index(resumed)), ...); }, m_instrumentation);
+					requeue_handles(frame, resumed + 1);
+					frame.clear();
+					throw;
+				}
+			}
+			else
+			{
+				resume_handle_range(frame, resumed);
+			}
+			frame.clear();
+		}
+
+		void resume_handle_range(queue_type& frame, std::size_t& resumed)
+		{
+			for (; resumed < frame.size(); ++resumed)
+			{
+				// Resume reads the resume address at the frame start, the body the promise and locals after it
+				if (m_prefetch_distance != 0 && resumed + m_prefetch_distance < frame.size())
+				{
+					auto ahead = static_cast<const char*>(frame[resumed + m_prefetch_distance].address());
+					detail::prefetch(ahead);
+					detail::prefetch(ahead + 64);
+				}
+
+				// Instrumentation gets the position the handle was queued at
+				std::apply([&frame, resumed](auto&... instrumentation) { (instrumentation.before_resume(frame.index(resumed)), ...); }, m_instrumentation);
+				frame[resumed].resume();
+				std::apply([&frame, resumed](auto&... instrumentation) { (instrumentation.after_resume(frame.index(resumed)), ...); }, m_instrumentation);
+			}
+		}
+
+		// Handles after the throwing one were not resumed yet, they stay scheduled
+		void requeue_handles(queue_type& frame, std::size_t first)
+		{
+			detail::queue_guard<threading_type> guard(m_threading);
+			auto& back = m_frames.back();
+			for (auto i = first; i < frame.size(); ++i)
+			{
+				if constexpr (fixed_capacity)
+				{
+					overflow_if_full("requeue");
+				}
+				back.push(frame[i]);
+			}
+		}
+
+		void resume_nodes(queue_type& frame)
+		{
+			// Node lives in the awaiter being resumed, the next one is read before the resume ends it
+			auto nodes = frame.nodes();
+			frame.clear();
+
+			std::size_t resumed = 0;
+			reactor_frame_node* next = nullptr;
+			if constexpr (exceptions)
+			{
+				try
+				{
+					resume_node_list(nodes, resumed, next);
+				}
+				catch (...)
+				{
+					std::apply([resumed](auto&... instrumentation) { (instrumentation.after_resume(resumed), ...); }, m_instrumentation);
+
+					// Nodes after the throwing one were not resumed yet, they stay scheduled
+					if (next)
+					{
+						reactor_frame_list rest{ next, nodes.m_last, nodes.m_size - resumed - 1 };
+						detail::queue_guard<threading_type> guard(m_threading);
+						m_frames.back().push(rest);
+					}
+					throw;
+				}
+			}
+			else
+			{
+				resume_node_list(nodes, resumed, next);
+			}
+		}
+
+		void resume_node_list(const reactor_frame_list& nodes, std::size_t& resumed, reactor_frame_node*& next)
+		{
+			for (auto node = nodes.m_first; node; node = next, ++resumed)
+			{
+				next = node->m_next;
+
+				// Only the next node is known, it sits in the next frame
+				if (next)
+				{
+					detail::prefetch(next);
+				}
+				std::apply([resumed](auto&... instrumentation) { (instrumentation.before_resume(resumed), ...); }, m_instrumentation);
+				node->m_handle.resume();
+				std::apply([resumed](auto&... instrumentation) { (instrumentation.after_resume(resumed), ...); }, m_instrumentation);
+			}
+		}
+
+		double_buffer<queue_type> m_frames;
+		reactor_frame_hook* m_hooks;
+		std::size_t m_prefetch_distance;
+		REACTOR_NO_UNIQUE_ADDRESS instrumentation_type m_instrumentation;
+		REACTOR_NO_UNIQUE_ADDRESS capacity_type m_capacity;
+		REACTOR_NO_UNIQUE_ADDRESS threading_type m_threading;
+		REACTOR_NO_UNIQUE_ADDRESS error_type m_errors;
+
+		REACTOR_NO_UNIQUE_ADDRESS detail::reference_to_pointer<T> m_reactor_default_frame_data;
 	};
 
-	template <class T>
+	template <class T, class... Policies>
 	class next_frame
 	{
 
 	public:
+		static constexpr const char* awaitable_name = "next_frame";
+
 		next_frame()
 			: m_scheduler(nullptr)
 		{
@@ -439,37 +2140,44 @@ namespace cppcoro
 			return false;
 		}
 
-		bool await_suspend(std::experimental::coroutine_handle<> awaitingCoroutine)
+		bool await_suspend(detail::coro::coroutine_handle<> awaitingCoroutine)
 		{
-			m_awaitingCoroutine = awaitingCoroutine;
-			m_scheduler->enqueue_update(m_awaitingCoroutine);
+			m_node.m_handle = awaitingCoroutine;
+			m_scheduler->enqueue_update(m_node, "next_frame");
 			return true;
 		}
 
 		decltype(auto) await_resume()
 		{
-			return m_scheduler->m_reactor_default_frame_data.get();
+			// Empty frame data does not touch the scheduler
+			if constexpr (detail::reference_to_pointer<T>::empty)
+			{
+				return T();
+			}
+			else
+			{
+				return m_scheduler->m_reactor_default_frame_data.get();
+			}
 		}
 
 	private:
-		friend class detail::reactor_coroutine_promise<T>;
+		friend class detail::reactor_promise_base<T, Policies...>;
 
-		template <class U, class V>
-		friend class detail::reactor_coroutine_promise_return;
-
-		std::experimental::coroutine_handle<> m_awaitingCoroutine;
-		reactor_scheduler<T>* m_scheduler;
+		reactor_frame_node m_node;
+		reactor_scheduler<T, Policies...>* m_scheduler;
 
 	};
 
 	namespace detail
 	{
-		template <class T>
+		template <class T, class... Policies>
 		class coroutine_awaitable
 		{
 
 		public:
-			coroutine_awaitable(reactor_scheduler<T>& scheduler, reactor_coroutine<T>& coroutine)
+			static constexpr const char* awaitable_name = "coroutine";
+
+			coroutine_awaitable(reactor_scheduler<T, Policies...>& scheduler, reactor_coroutine<T, Policies...>& coroutine)
 				: m_scheduler(&scheduler), m_coroutine(coroutine)
 			{
 			}
@@ -479,16 +2187,15 @@ namespace cppcoro
 				return false;
 			}
 
-			bool await_suspend(std::experimental::coroutine_handle<> awaitingCoroutine)
+			// Child starts right away, awaiting coroutine continues when it completes
+			coro::coroutine_handle<> await_suspend(coro::coroutine_handle<> awaitingCoroutine)
 			{
 				auto& promise = m_coroutine.m_coroutine.promise();
-				assert(promise.m_awaiter == nullptr);
-				promise.m_awaiter = this;
-
-				m_awaitingCoroutine = awaitingCoroutine;
+				assert(!promise.m_continuation);
+				promise.m_continuation = awaitingCoroutine;
 
 				m_coroutine.schedule(*m_scheduler);
-				return m_coroutine.update_next_frame();
+				return m_coroutine.m_coroutine;
 			}
 
 			decltype(auto) await_resume()
@@ -500,20 +2207,18 @@ namespace cppcoro
 			}
 
 		private:
-			friend class reactor_coroutine_promise<T>;
-
-			reactor_coroutine<T>& m_coroutine;
-			reactor_scheduler<T>* m_scheduler;
-			std::experimental::coroutine_handle<> m_awaitingCoroutine;
-
+			reactor_coroutine<T, Policies...>& m_coroutine;
+			reactor_scheduler<T, Policies...>* m_scheduler;
 		};
 
-		template <class R, class T>
+		template <class R, class T, class... Policies>
 		class coroutine_awaitable_return
 		{
 
 		public:
-			coroutine_awaitable_return(reactor_scheduler<T>& scheduler, reactor_coroutine_return<R, T>& coroutine)
+			static constexpr const char* awaitable_name = "coroutine";
+
+			coroutine_awaitable_return(reactor_scheduler<T, Policies...>& scheduler, reactor_coroutine_return<R, T, Policies...>& coroutine)
 				: m_scheduler(&scheduler), m_coroutine(coroutine)
 			{
 			}
@@ -523,16 +2228,15 @@ namespace cppcoro
 				return false;
 			}
 
-			bool await_suspend(std::experimental::coroutine_handle<> awaitingCoroutine)
+			// Child starts right away, awaiting coroutine continues when it completes
+			coro::coroutine_handle<> await_suspend(coro::coroutine_handle<> awaitingCoroutine)
 			{
 				auto& promise = m_coroutine.m_coroutine.promise();
-				assert(promise.m_awaiter == nullptr);
-				promise.m_awaiter = this;
-
-				m_awaitingCoroutine = awaitingCoroutine;
+				assert(!promise.m_continuation);
+				promise.m_continuation = awaitingCoroutine;
 
 				m_coroutine.schedule(*m_scheduler);
-				return m_coroutine.update_next_frame();
+				return m_coroutine.m_coroutine;
 			}
 
 			decltype(auto) await_resume()
@@ -541,97 +2245,231 @@ namespace cppcoro
 
 				promise.rethrow_if_exception();
 
-				return promise.get_value();
+				return promise.take_value();
+			}
+
+		private:
+			reactor_coroutine_return<R, T, Policies...>& m_coroutine;
+			reactor_scheduler<T, Policies...>* m_scheduler;
+		};
+
+		// Keeps the shared coroutine alive while waiting, node links the awaiter to the others
+		template <class R, class T, class... Policies>
+		class shared_coroutine_awaitable
+		{
+
+		public:
+			static constexpr const char* awaitable_name = "shared_coroutine";
+
+			shared_coroutine_awaitable(reactor_scheduler<T, Policies...>& scheduler, const reactor_shared_coroutine_return<R, T, Policies...>& coroutine)
+				: m_scheduler(&scheduler), m_coroutine(coroutine)
+			{
+			}
+
+			bool await_ready() const noexcept
+			{
+				return m_coroutine.done();
+			}
+
+			// First awaiter starts it right away, the rest only wait
+			coro::coroutine_handle<> await_suspend(coro::coroutine_handle<> awaitingCoroutine)
+			{
+				auto& promise = m_coroutine.m_coroutine.promise();
+				m_node.m_handle = awaitingCoroutine;
+				promise.m_waiters.push_back(m_node);
+
+				if (!promise.m_scheduler)
+				{
+					promise.schedule(*m_scheduler, m_coroutine.m_coroutine.address());
+					return m_coroutine.m_coroutine;
+				}
+				assert(promise.m_scheduler == m_scheduler);
+				return coro::noop_coroutine();
+			}
+
+			const R& await_resume()
+			{
+				auto& promise = m_coroutine.m_coroutine.promise();
+				promise.rethrow_if_exception();
+
+				return promise.value();
+			}
+
+		private:
+			reactor_scheduler<T, Policies...>* m_scheduler;
+			reactor_shared_coroutine_return<R, T, Policies...> m_coroutine;
+			reactor_frame_node m_node;
+		};
+
+		template <class Y, class T, class... Policies>
+		class generator_next_awaitable
+		{
+
+		public:
+			static constexpr const char* awaitable_name = "generator";
+
+			explicit generator_next_awaitable(reactor_generator<Y, T, Policies...>& generator)
+				: m_generator(&generator), m_scheduler(nullptr)
+			{
+			}
+
+			bool await_ready() const noexcept
+			{
+				return m_generator->done();
+			}
+
+			// Generator continues right away, it resumes the consumer when it yields or completes
+			coro::coroutine_handle<> await_suspend(coro::coroutine_handle<> awaitingCoroutine)
+			{
+				auto& promise = m_generator->m_coroutine.promise();
+				assert(!promise.m_continuation);
+				promise.m_continuation = awaitingCoroutine;
+				promise.m_yielded = nullptr;
+
+				if (!promise.m_scheduler)
+				{
+					promise.schedule(*m_scheduler, m_generator->m_coroutine.address());
+				}
+				assert(promise.m_scheduler == m_scheduler);
+				return m_generator->m_coroutine;
+			}
+
+			Y* await_resume()
+			{
+				if (!m_generator->m_coroutine)
+				{
+					return nullptr;
+				}
+
+				auto& promise = m_generator->m_coroutine.promise();
+				promise.rethrow_if_exception();
+				return m_generator->m_coroutine.done() ? nullptr : promise.m_yielded;
 			}
 
 		private:
-			friend class reactor_coroutine_promise_return<R, T>;
+			template <class, class... Ps>
+			friend class reactor_promise_base;
 
-			reactor_coroutine_return<R, T>& m_coroutine;
-			reactor_scheduler<T>* m_scheduler;
-			std::experimental::coroutine_handle<> m_awaitingCoroutine;
+			reactor_generator<Y, T, Policies...>* m_generator;
+			reactor_scheduler<T, Policies...>* m_scheduler;
 		};
 	}
 
 
 
-	template <class T = reactor_default_frame_data>
-	void swap(reactor_coroutine<T>& a, reactor_coroutine<T>& b)
+	template <class T = reactor_default_frame_data, class... Policies>
+	void swap(reactor_coroutine<T, Policies...>& a, reactor_coroutine<T, Policies...>& b)
+	{
+		a.swap(b);
+	}
+
+	template <class R, class T = reactor_default_frame_data, class... Policies>
+	void swap(reactor_coroutine_return<R, T, Policies...>& a, reactor_coroutine_return<R, T, Policies...>& b)
+	{
+		a.swap(b);
+	}
+
+	template <class R, class T = reactor_default_frame_data, class... Policies>
+	void swap(reactor_shared_coroutine_return<R, T, Policies...>& a, reactor_shared_coroutine_return<R, T, Policies...>& b)
 	{
 		a.swap(b);
 	}
 
-	template <class R, class T = reactor_default_frame_data>
-	void swap(reactor_coroutine_return<R,T>& a, reactor_coroutine_return<R,T>& b)
+	template <class Y, class T = reactor_default_frame_data, class... Policies>
+	void swap(reactor_generator<Y, T, Policies...>& a, reactor_generator<Y, T, Policies...>& b)
 	{
 		a.swap(b);
 	}
 
 	namespace detail
 	{
-		template <class T>
-		reactor_coroutine<T> reactor_coroutine_promise<T>::get_return_object() noexcept
+		template <class T, class... Policies>
+		reactor_coroutine<T, Policies...> reactor_coroutine_promise<T, Policies...>::get_return_object() noexcept
 		{
-			using coroutine_handle = std::experimental::coroutine_handle<reactor_coroutine_promise<T> >;
-			return reactor_coroutine{ coroutine_handle::from_promise(*this) };
+			using coroutine_handle = coro::coroutine_handle<reactor_coroutine_promise<T, Policies...> >;
+			return reactor_coroutine<T, Policies...>{ coroutine_handle::from_promise(*this) };
 		}
 
-		template <class T>
-		next_frame<T> reactor_coroutine_promise<T>::await_transform(next_frame<T>&& awaitable)
+		template <class R, class T, class... Policies>
+		reactor_coroutine_return<R, T, Policies...> reactor_coroutine_promise_return<R, T, Policies...>::get_return_object() noexcept
+		{
+			using coroutine_handle = coro::coroutine_handle<reactor_coroutine_promise_return<R, T, Policies...> >;
+			return reactor_coroutine_return<R, T, Policies...>{ coroutine_handle::from_promise(*this) };
+		}
+
+		template <class T, class... Policies>
+		template <class... P>
+		auto reactor_promise_base<T, Policies...>::await_transform(next_frame<T, P...>&&) -> instrumented_t<next_frame<T, Policies...> >
 		{
 			assert(m_scheduler != nullptr);
+			next_frame<T, Policies...> awaitable;
 			awaitable.m_scheduler = m_scheduler;
 
-			return awaitable;
+			return instrument_awaitable(std::move(awaitable), false);
 		}
 
-		template <class T>
-		coroutine_awaitable<T> reactor_coroutine_promise<T>::await_transform(reactor_coroutine<T>&& awaitable)
+		template <class T, class... Policies>
+		auto reactor_promise_base<T, Policies...>::await_transform(reactor_coroutine<T, Policies...>&& awaitable) -> instrumented_t<coroutine_awaitable<T, Policies...> >
 		{
-			assert(m_scheduler != nullptr);			
-			return coroutine_awaitable{ *m_scheduler, awaitable };
+			assert(m_scheduler != nullptr);
+			return instrument_awaitable(coroutine_awaitable<T, Policies...>{ *m_scheduler, awaitable }, true);
 		}
 
-		template <class T>
+		template <class T, class... Policies>
 		template <class U>
-		coroutine_awaitable_return<U, T> reactor_coroutine_promise<T>::await_transform(reactor_coroutine_return<U, T>&& awaitable)
+		auto reactor_promise_base<T, Policies...>::await_transform(reactor_coroutine_return<U, T, Policies...>&& awaitable) -> instrumented_t<coroutine_awaitable_return<U, T, Policies...> >
 		{
 			assert(m_scheduler != nullptr);
-			return coroutine_awaitable_return<U,T>{ *m_scheduler, awaitable };
+			return instrument_awaitable(coroutine_awaitable_return<U, T, Policies...>{ *m_scheduler, awaitable }, true);
 		}
 
-
-		template <class R, class T>
-		reactor_coroutine_return<R,T> reactor_coroutine_promise_return<R,T>::get_return_object() noexcept
+		template <class R, class T, class... Policies>
+		reactor_shared_coroutine_return<R, T, Policies...> reactor_shared_coroutine_promise<R, T, Policies...>::get_return_object() noexcept
 		{
-			using coroutine_handle = std::experimental::coroutine_handle<reactor_coroutine_promise_return<R,T> >;
-			return reactor_coroutine_return{ coroutine_handle::from_promise(*this) };
+			using coroutine_handle = coro::coroutine_handle<reactor_shared_coroutine_promise<R, T, Policies...> >;
+			return reactor_shared_coroutine_return<R, T, Policies...>{ coroutine_handle::from_promise(*this) };
 		}
 
-		template <class R, class T>
-		next_frame<T> reactor_coroutine_promise_return<R, T>::await_transform(next_frame<T>&& awaitable)
+		template <class T, class... Policies>
+		template <class U>
+		auto reactor_promise_base<T, Policies...>::await_transform(reactor_shared_coroutine_return<U, T, Policies...>& awaitable) -> instrumented_t<shared_coroutine_awaitable<U, T, Policies...> >
 		{
 			assert(m_scheduler != nullptr);
-			awaitable.m_scheduler = m_scheduler;
+			// Empty one counts as done and would be read as finished without a promise
+			assert(awaitable.m_coroutine);
 
-			return awaitable;
+			// Only the awaiter starting it is its parent
+			bool child = !awaitable.done() && !awaitable.m_coroutine.promise().m_scheduler;
+			return instrument_awaitable(shared_coroutine_awaitable<U, T, Policies...>{ *m_scheduler, awaitable }, child);
 		}
 
-		template <class R, class T>
-		coroutine_awaitable<T> reactor_coroutine_promise_return<R, T>::await_transform(reactor_coroutine<T>&& awaitable)
+		template <class T, class... Policies>
+		template <class U>
+		auto reactor_promise_base<T, Policies...>::await_transform(reactor_shared_coroutine_return<U, T, Policies...>&& awaitable) -> instrumented_t<shared_coroutine_awaitable<U, T, Policies...> >
 		{
-			assert(m_scheduler != nullptr);
-			return coroutine_awaitable{ *m_scheduler, awaitable };
+			return await_transform(awaitable);
 		}
 
-		template <class R, class T>
-		template <class U>
-		coroutine_awaitable_return<U, T> reactor_coroutine_promise_return<R, T>::await_transform(reactor_coroutine_return<U, T>&& awaitable)
+		template <class Y, class T, class... Policies>
+		reactor_generator<Y, T, Policies...> reactor_generator_promise<Y, T, Policies...>::get_return_object() noexcept
+		{
+			using coroutine_handle = coro::coroutine_handle<reactor_generator_promise<Y, T, Policies...> >;
+			return reactor_generator<Y, T, Policies...>{ coroutine_handle::from_promise(*this) };
+		}
+
+		template <class T, class... Policies>
+		template <class Y>
+		auto reactor_promise_base<T, Policies...>::await_transform(generator_next_awaitable<Y, T, Policies...>&& awaitable) -> instrumented_t<generator_next_awaitable<Y, T, Policies...> >
 		{
 			assert(m_scheduler != nullptr);
-			return coroutine_awaitable_return{ *m_scheduler, awaitable };
+			awaitable.m_scheduler = m_scheduler;
+
+			// Only the first next() starts it as a child
+			auto& generator = *awaitable.m_generator;
+			bool child = !generator.done() && !generator.m_coroutine.promise().m_scheduler;
+			return instrument_awaitable(std::move(awaitable), child);
 		}
 	}
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,183 @@
+#ifndef REACTOR_EXPECTED_HPP_INCLUDED
+#define REACTOR_EXPECTED_HPP_INCLUDED
+
+#include "reactor_coroutine.hpp"
+
+#include <cassert>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace cppcoro
+{
+	// Error to construct a failed reactor_expected from
+	template <class E>
+	class reactor_unexpected
+	{
+	public:
+		explicit reactor_unexpected(E error) noexcept(std::is_nothrow_move_constructible<E>::value)
+			: m_error(std::move(error))
+		{
+		}
+
+		E& error() noexcept
+		{
+			return m_error;
+		}
+
+		const E& error() const noexcept
+		{
+			return m_error;
+		}
+
+	private:
+		E m_error;
+	};
+
+	// Value or error returned by coroutines built without exceptions. Failures travel through nested
+	// awaits as return values, every level checks and returns the error to its awaiter:
+	//
+	//   typedef reactor_coroutine_return<reactor_expected<mesh, load_error>, frame, reactor_no_exceptions> load_mesh;
+	//
+	//   auto file = co_await read_file(path);
+	//   if (!file)
+	//      co_return reactor_unexpected(file.error());
+	//
+	// Accessing the side that is not there is checked with assert only.
+	template <class R, class E>
+	class reactor_expected
+	{
+	public:
+		reactor_expected(const R& value)
+			: m_has_value(true)
+		{
+			new (&m_value) R(value);
+		}
+
+		reactor_expected(R&& value) noexcept(std::is_nothrow_move_constructible<R>::value)
+			: m_has_value(true)
+		{
+			new (&m_value) R(std::move(value));
+		}
+
+		template <class F>
+		reactor_expected(reactor_unexpected<F> error) noexcept(std::is_nothrow_constructible<E, F&&>::value)
+			: m_has_value(false)
+		{
+			new (&m_error) E(std::move(error.error()));
+		}
+
+		reactor_expected(const reactor_expected& other)
+			: m_has_value(other.m_has_value)
+		{
+			if (m_has_value)
+			{
+				new (&m_value) R(other.m_value);
+			}
+			else
+			{
+				new (&m_error) E(other.m_error);
+			}
+		}
+
+		reactor_expected(reactor_expected&& other) noexcept(std::is_nothrow_move_constructible<R>::value && std::is_nothrow_move_constructible<E>::value)
+			: m_has_value(other.m_has_value)
+		{
+			if (m_has_value)
+			{
+				new (&m_value) R(std::move(other.m_value));
+			}
+			else
+			{
+				new (&m_error) E(std::move(other.m_error));
+			}
+		}
+
+		// Value or error is replaced by destroying it and moving in the other one, moving has to be
+		// noexcept so a failure cannot leave this destroyed. Copies are made before, in the argument.
+		reactor_expected& operator=(reactor_expected other) noexcept
+		{
+			static_assert(std::is_nothrow_move_constructible<R>::value && std::is_nothrow_move_constructible<E>::value,
+				"reactor_expected is assignable only with noexcept move constructible value and error");
+			this->~reactor_expected();
+			new (this) reactor_expected(std::move(other));
+			return *this;
+		}
+
+		~reactor_expected()
+		{
+			if (m_has_value)
+			{
+				m_value.~R();
+			}
+			else
+			{
+				m_error.~E();
+			}
+		}
+
+		bool has_value() const noexcept
+		{
+			return m_has_value;
+		}
+
+		explicit operator bool() const noexcept
+		{
+			return m_has_value;
+		}
+
+		R& value() noexcept
+		{
+			assert(m_has_value);
+			return m_value;
+		}
+
+		const R& value() const noexcept
+		{
+			assert(m_has_value);
+			return m_value;
+		}
+
+		R& operator*() noexcept
+		{
+			return value();
+		}
+
+		const R& operator*() const noexcept
+		{
+			return value();
+		}
+
+		R* operator->() noexcept
+		{
+			return &value();
+		}
+
+		const R* operator->() const noexcept
+		{
+			return &value();
+		}
+
+		E& error() noexcept
+		{
+			assert(!m_has_value);
+			return m_error;
+		}
+
+		const E& error() const noexcept
+		{
+			assert(!m_has_value);
+			return m_error;
+		}
+
+	private:
+		union
+		{
+			R m_value;
+			E m_error;
+		};
+		bool m_has_value;
+	};
+}
+
+#endif
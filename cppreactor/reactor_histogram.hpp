@@ -0,0 +1,306 @@
+#ifndef REACTOR_HISTOGRAM_HPP_INCLUDED
+#define REACTOR_HISTOGRAM_HPP_INCLUDED
+
+#include "reactor_coroutine.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <vector>
+
+namespace cppcoro
+{
+	// Log-linear histogram of unsigned values in the spirit of HDR histograms. Every power of two
+	// range is split into 32 buckets, so percentiles are within about 3% of the recorded values.
+	// Recording is a few instructions and never allocates.
+	class reactor_histogram
+	{
+	public:
+		static constexpr unsigned sub_bucket_bits = 5;
+		static constexpr std::uint64_t sub_buckets = 1 << sub_bucket_bits;
+		static constexpr std::size_t bucket_count = (64 - sub_bucket_bits + 1) * sub_buckets;
+
+		reactor_histogram()
+		{
+			reset();
+		}
+
+		void record(std::uint64_t value)
+		{
+			++m_counts[index_of(value)];
+			++m_count;
+			m_sum += value;
+			m_min = std::min(m_min, value);
+			m_max = std::max(m_max, value);
+		}
+
+		void reset()
+		{
+			m_counts.fill(0);
+			m_count = 0;
+			m_sum = 0;
+			m_min = std::numeric_limits<std::uint64_t>::max();
+			m_max = 0;
+		}
+
+		std::uint64_t count() const
+		{
+			return m_count;
+		}
+
+		std::uint64_t min() const
+		{
+			return m_count ? m_min : 0;
+		}
+
+		std::uint64_t max() const
+		{
+			return m_max;
+		}
+
+		double mean() const
+		{
+			return m_count ? double(m_sum) / double(m_count) : 0.0;
+		}
+
+		// Highest value of the bucket holding given percentile (0-100), capped by the recorded maximum
+		std::uint64_t percentile(double percent) const
+		{
+			if (m_count == 0)
+			{
+				return 0;
+			}
+
+			auto rank = std::uint64_t(percent / 100.0 * double(m_count) + 0.5);
+			rank = std::max<std::uint64_t>(1, std::min(rank, m_count));
+
+			std::uint64_t seen = 0;
+			for (std::size_t i = 0; i < bucket_count; i++)
+			{
+				seen += m_counts[i];
+				if (seen >= rank)
+				{
+					return std::min(highest_of(i), m_max);
+				}
+			}
+			return m_max;
+		}
+
+	private:
+		static std::size_t index_of(std::uint64_t value)
+		{
+			if (value < sub_buckets)
+			{
+				return std::size_t(value);
+			}
+
+			unsigned exponent = unsigned(std::bit_width(value)) - 1;
+			unsigned shift = exponent - sub_bucket_bits;
+			return std::size_t((exponent - sub_bucket_bits + 1) * sub_buckets + ((value >> shift) - sub_buckets));
+		}
+
+		static std::uint64_t highest_of(std::size_t index)
+		{
+			if (index < sub_buckets)
+			{
+				return index;
+			}
+
+			unsigned shift = unsigned(index / sub_buckets) - 1;
+			std::uint64_t mantissa = index % sub_buckets + sub_buckets;
+			return ((mantissa + 1) << shift) - 1;
+		}
+
+		std::array<std::uint64_t, bucket_count> m_counts;
+		std::uint64_t m_count;
+		std::uint64_t m_sum;
+		std::uint64_t m_min;
+		std::uint64_t m_max;
+	};
+
+	// Frame that went over the hitch threshold, with the longest resumes that happened in it
+	struct reactor_frame_hitch
+	{
+		struct resume
+		{
+			const void* m_coroutine;
+			std::chrono::nanoseconds m_duration;
+		};
+
+		std::uint64_t m_frame;
+		std::chrono::nanoseconds m_duration;
+		std::size_t m_queued;
+		std::size_t m_started;
+		std::vector<resume> m_slowest;
+	};
+
+	// Instrumentation policy keeping histograms of update_next_frame durations in nanoseconds,
+	// handles resumed per frame and coroutines started per frame. With a hitch threshold set,
+	// every resume is timed and frames over the threshold are reported with their slowest resumes.
+	class reactor_frame_histogram : public reactor_instrumentation
+	{
+	public:
+		typedef std::chrono::steady_clock clock;
+
+		static constexpr std::size_t slowest_resumes = 8;
+
+		struct coroutine_data
+		{
+			const void* m_coroutine = nullptr;
+			clock::time_point m_resumed_at;
+		};
+
+		reactor_frame_histogram()
+			: m_frame(0), m_queued(0), m_started(0), m_slowest_count(0), m_hitches(0), m_threshold(clock::duration::max())
+		{
+		}
+
+		reactor_frame_histogram(const reactor_frame_histogram&) = delete;
+		reactor_frame_histogram& operator=(const reactor_frame_histogram&) = delete;
+
+		// Frames longer than threshold are passed to callback after they end
+		void set_hitch_threshold(std::chrono::nanoseconds threshold, std::function<void(const reactor_frame_hitch&)> callback = nullptr)
+		{
+			m_threshold = std::chrono::duration_cast<clock::duration>(threshold);
+			m_callback = std::move(callback);
+		}
+
+		const reactor_histogram& frame_times() const
+		{
+			return m_frame_times;
+		}
+
+		const reactor_histogram& queue_lengths() const
+		{
+			return m_queue_lengths;
+		}
+
+		const reactor_histogram& starts() const
+		{
+			return m_starts;
+		}
+
+		std::uint64_t hitches() const
+		{
+			return m_hitches;
+		}
+
+		const reactor_frame_hitch& last_hitch() const
+		{
+			return m_last_hitch;
+		}
+
+		void reset()
+		{
+			m_frame_times.reset();
+			m_queue_lengths.reset();
+			m_starts.reset();
+			m_hitches = 0;
+		}
+
+		void begin_frame()
+		{
+			++m_frame;
+			m_slowest_count = 0;
+			m_frame_start = clock::now();
+		}
+
+		void on_frame_queue(std::size_t queued)
+		{
+			m_queued = queued;
+		}
+
+		void end_frame()
+		{
+			auto duration = clock::now() - m_frame_start;
+			m_frame_times.record(std::uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count()));
+			m_queue_lengths.record(m_queued);
+			m_starts.record(m_started);
+
+			if (duration > m_threshold)
+			{
+				report_hitch(duration);
+			}
+			m_started = 0;
+		}
+
+		void on_schedule(coroutine_data& data, const void* address)
+		{
+			data.m_coroutine = address;
+			++m_started;
+		}
+
+		void on_resume(coroutine_data& data, bool)
+		{
+			if (m_threshold != clock::duration::max())
+			{
+				data.m_resumed_at = clock::now();
+			}
+		}
+
+		void on_suspend(coroutine_data& data, bool)
+		{
+			if (m_threshold != clock::duration::max())
+			{
+				keep_if_slow({ data.m_coroutine, std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - data.m_resumed_at) });
+			}
+		}
+
+	private:
+		// Keeps the longest resumes of the frame sorted, longest first
+		void keep_if_slow(reactor_frame_hitch::resume resume)
+		{
+			if (m_slowest_count == slowest_resumes && resume.m_duration <= m_slowest[slowest_resumes - 1].m_duration)
+			{
+				return;
+			}
+
+			std::size_t i = std::min(m_slowest_count, slowest_resumes - 1);
+			for (; i > 0 && m_slowest[i - 1].m_duration < resume.m_duration; --i)
+			{
+				m_slowest[i] = m_slowest[i - 1];
+			}
+			m_slowest[i] = resume;
+			m_slowest_count = std::min(m_slowest_count + 1, slowest_resumes);
+		}
+
+		void report_hitch(clock::duration duration)
+		{
+			++m_hitches;
+			m_last_hitch.m_frame = m_frame;
+			m_last_hitch.m_duration = std::chrono::duration_cast<std::chrono::nanoseconds>(duration);
+			m_last_hitch.m_queued = m_queued;
+			m_last_hitch.m_started = m_started;
+			m_last_hitch.m_slowest.assign(m_slowest.begin(), m_slowest.begin() + m_slowest_count);
+
+			if (m_callback)
+			{
+				m_callback(m_last_hitch);
+			}
+		}
+
+		reactor_histogram m_frame_times;
+		reactor_histogram m_queue_lengths;
+		reactor_histogram m_starts;
+
+		clock::time_point m_frame_start;
+		std::uint64_t m_frame;
+		std::size_t m_queued;
+		std::size_t m_started;
+
+		std::array<reactor_frame_hitch::resume, slowest_resumes> m_slowest;
+		std::size_t m_slowest_count;
+
+		reactor_frame_hitch m_last_hitch{};
+		std::uint64_t m_hitches;
+		clock::duration m_threshold;
+		std::function<void(const reactor_frame_hitch&)> m_callback;
+	};
+}
+
+#endif
@@ -0,0 +1,536 @@
+#ifndef REACTOR_IO_HPP_INCLUDED
+#define REACTOR_IO_HPP_INCLUDED
+
+#include "reactor_coroutine.hpp"
+
+#ifdef __linux__
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <system_error>
+#include <vector>
+
+namespace cppcoro
+{
+	enum class reactor_io_backend
+	{
+		// One io_uring_enter per frame for all operations awaited in that frame
+		io_uring,
+		// Non-blocking syscalls performed at frame end, used when io_uring is not available
+		synchronous
+	};
+
+	template <class T = reactor_default_frame_data, class... Policies>
+	class reactor_io;
+
+	template <class T = reactor_default_frame_data, class... Policies>
+	class reactor_io_operation;
+
+	namespace detail
+	{
+		// Lives inside the awaiting coroutine frame for the whole time operation is in flight
+		struct io_operation
+		{
+			unsigned char m_opcode;
+			int m_fd;
+			void* m_buffer;
+			unsigned m_size;
+			std::uint64_t m_offset;
+			int m_flags;
+			int m_result;
+			reactor_frame_node m_node;
+		};
+
+		// Minimal io_uring ring on top of raw syscalls, without liburing dependency
+		class io_uring_queue
+		{
+		public:
+			io_uring_queue()
+				: m_fd(-1), m_sq_ring(nullptr), m_cq_ring(nullptr), m_sqes(nullptr),
+				m_sq_ring_size(0), m_cq_ring_size(0), m_sqes_size(0), m_sq_tail(0), m_in_flight(0)
+			{
+			}
+
+			io_uring_queue(const io_uring_queue&) = delete;
+			io_uring_queue& operator=(const io_uring_queue&) = delete;
+
+			~io_uring_queue()
+			{
+				close();
+			}
+
+			bool open(unsigned entries)
+			{
+				io_uring_params params;
+				std::memset(&params, 0, sizeof(params));
+
+				m_fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+				if (m_fd < 0)
+				{
+					m_fd = -1;
+					return false;
+				}
+
+				m_sq_entries = params.sq_entries;
+				m_cq_entries = params.cq_entries;
+
+				m_sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+				m_cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+				bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+				if (single_mmap)
+				{
+					m_sq_ring_size = m_cq_ring_size = std::max(m_sq_ring_size, m_cq_ring_size);
+				}
+
+				m_sq_ring = ::mmap(nullptr, m_sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQ_RING);
+				if (m_sq_ring == MAP_FAILED)
+				{
+					m_sq_ring = nullptr;
+					close();
+					return false;
+				}
+
+				if (single_mmap)
+				{
+					m_cq_ring = m_sq_ring;
+				}
+				else
+				{
+					m_cq_ring = ::mmap(nullptr, m_cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_CQ_RING);
+					if (m_cq_ring == MAP_FAILED)
+					{
+						m_cq_ring = nullptr;
+						close();
+						return false;
+					}
+				}
+
+				m_sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+				void* sqes = ::mmap(nullptr, m_sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_fd, IORING_OFF_SQES);
+				if (sqes == MAP_FAILED)
+				{
+					close();
+					return false;
+				}
+				m_sqes = static_cast<io_uring_sqe*>(sqes);
+
+				auto sq = static_cast<unsigned char*>(m_sq_ring);
+				m_sq_head = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+				m_sq_tail_shared = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+				m_sq_mask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+				m_sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+				m_sq_tail = *m_sq_tail_shared;
+
+				auto cq = static_cast<unsigned char*>(m_cq_ring);
+				m_cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+				m_cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+				m_cq_mask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+				m_cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+				if (!supports({ IORING_OP_READ, IORING_OP_WRITE, IORING_OP_RECV, IORING_OP_SEND }))
+				{
+					close();
+					return false;
+				}
+
+				return true;
+			}
+
+			bool is_open() const
+			{
+				return m_fd >= 0;
+			}
+
+			// Never keep more operations in flight than completion queue can hold
+			bool can_prepare() const
+			{
+				unsigned queued = m_sq_tail - __atomic_load_n(m_sq_head, __ATOMIC_ACQUIRE);
+				return queued < m_sq_entries && m_in_flight < m_cq_entries;
+			}
+
+			void prepare(io_operation& operation)
+			{
+				unsigned index = m_sq_tail & m_sq_mask;
+				io_uring_sqe& sqe = m_sqes[index];
+				std::memset(&sqe, 0, sizeof(sqe));
+
+				sqe.opcode = operation.m_opcode;
+				sqe.fd = operation.m_fd;
+				sqe.addr = reinterpret_cast<std::uint64_t>(operation.m_buffer);
+				sqe.len = operation.m_size;
+				sqe.off = operation.m_offset;
+				sqe.msg_flags = static_cast<std::uint32_t>(operation.m_flags);
+				sqe.user_data = reinterpret_cast<std::uint64_t>(&operation);
+
+				m_sq_array[index] = index;
+				++m_sq_tail;
+				++m_in_flight;
+			}
+
+			// Single syscall for everything prepared since last submit
+			void submit()
+			{
+				__atomic_store_n(m_sq_tail_shared, m_sq_tail, __ATOMIC_RELEASE);
+
+				unsigned to_submit = m_sq_tail - __atomic_load_n(m_sq_head, __ATOMIC_ACQUIRE);
+				if (to_submit == 0)
+				{
+					return;
+				}
+
+				// Busy or interrupted submissions stay in the ring and are retried next frame
+				int submitted = static_cast<int>(syscall(__NR_io_uring_enter, m_fd, to_submit, 0, 0, nullptr, 0));
+				if (submitted < 0 && errno != EAGAIN && errno != EBUSY && errno != EINTR)
+				{
+					throw std::system_error(errno, std::generic_category(), "io_uring_enter");
+				}
+			}
+
+			// Does not wait, only collects what already completed
+			template <class F>
+			void reap(F&& completed)
+			{
+				unsigned head = *m_cq_head;
+				unsigned tail = __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE);
+
+				for (; head != tail; ++head)
+				{
+					io_uring_cqe& cqe = m_cqes[head & m_cq_mask];
+					--m_in_flight;
+					// Cancel requests carry no operation
+					if (cqe.user_data)
+					{
+						completed(*reinterpret_cast<io_operation*>(cqe.user_data), cqe.res);
+					}
+				}
+
+				__atomic_store_n(m_cq_head, head, __ATOMIC_RELEASE);
+			}
+
+			// Blocks until kernel no longer touches any submitted operation. Operations still in
+			// flight are cancelled and their completions dropped. Operations that are already
+			// running, or every operation on kernels older than 5.19, are waited for instead.
+			void cancel_all()
+			{
+				bool cancel_queued = false;
+				while (m_in_flight > 0)
+				{
+					if (!cancel_queued && m_sq_tail - __atomic_load_n(m_sq_head, __ATOMIC_ACQUIRE) < m_sq_entries)
+					{
+						unsigned index = m_sq_tail & m_sq_mask;
+						io_uring_sqe& sqe = m_sqes[index];
+						std::memset(&sqe, 0, sizeof(sqe));
+						sqe.opcode = IORING_OP_ASYNC_CANCEL;
+						sqe.fd = -1;
+						sqe.cancel_flags = IORING_ASYNC_CANCEL_ALL | IORING_ASYNC_CANCEL_ANY;
+
+						m_sq_array[index] = index;
+						++m_sq_tail;
+						++m_in_flight;
+						cancel_queued = true;
+					}
+
+					__atomic_store_n(m_sq_tail_shared, m_sq_tail, __ATOMIC_RELEASE);
+					unsigned to_submit = m_sq_tail - __atomic_load_n(m_sq_head, __ATOMIC_ACQUIRE);
+					int result = static_cast<int>(syscall(__NR_io_uring_enter, m_fd, to_submit, 1, IORING_ENTER_GETEVENTS, nullptr, 0));
+					if (result < 0 && errno != EAGAIN && errno != EBUSY && errno != EINTR)
+					{
+						// Ring is unusable, nothing more can be waited for
+						return;
+					}
+
+					reap([](io_operation&, int) {});
+				}
+			}
+
+		private:
+			bool supports(std::initializer_list<unsigned char> opcodes)
+			{
+				const unsigned probe_ops = 256;
+				std::vector<unsigned char> storage(sizeof(io_uring_probe) + probe_ops * sizeof(io_uring_probe_op));
+				auto probe = reinterpret_cast<io_uring_probe*>(storage.data());
+
+				if (syscall(__NR_io_uring_register, m_fd, IORING_REGISTER_PROBE, probe, probe_ops) < 0)
+				{
+					return false;
+				}
+
+				for (auto opcode : opcodes)
+				{
+					if (opcode > probe->last_op || !(probe->ops[opcode].flags & IO_URING_OP_SUPPORTED))
+					{
+						return false;
+					}
+				}
+				return true;
+			}
+
+			void close()
+			{
+				if (m_sqes)
+				{
+					::munmap(m_sqes, m_sqes_size);
+					m_sqes = nullptr;
+				}
+				if (m_cq_ring && m_cq_ring != m_sq_ring)
+				{
+					::munmap(m_cq_ring, m_cq_ring_size);
+				}
+				m_cq_ring = nullptr;
+				if (m_sq_ring)
+				{
+					::munmap(m_sq_ring, m_sq_ring_size);
+					m_sq_ring = nullptr;
+				}
+				if (m_fd >= 0)
+				{
+					::close(m_fd);
+					m_fd = -1;
+				}
+			}
+
+			int m_fd;
+			void* m_sq_ring;
+			void* m_cq_ring;
+			io_uring_sqe* m_sqes;
+			std::size_t m_sq_ring_size;
+			std::size_t m_cq_ring_size;
+			std::size_t m_sqes_size;
+
+			unsigned m_sq_entries;
+			unsigned m_cq_entries;
+
+			unsigned* m_sq_head;
+			unsigned* m_sq_tail_shared;
+			unsigned* m_sq_array;
+			unsigned m_sq_mask;
+			unsigned m_sq_tail;
+
+			unsigned* m_cq_head;
+			unsigned* m_cq_tail;
+			unsigned m_cq_mask;
+			io_uring_cqe* m_cqes;
+
+			unsigned m_in_flight;
+		};
+	}
+
+	// File and socket I/O for coroutines of one scheduler. Operations awaited during a frame
+	// are submitted together at the end of the frame and resumed in the frame they are reaped.
+	template <class T, class... Policies>
+	class reactor_io : private reactor_frame_hook
+	{
+	public:
+		explicit reactor_io(reactor_scheduler<T, Policies...>& scheduler, unsigned entries = 256,
+			reactor_io_backend preferred = reactor_io_backend::io_uring)
+			: m_scheduler(&scheduler), m_backend(reactor_io_backend::synchronous)
+		{
+			if (preferred == reactor_io_backend::io_uring && m_ring.open(entries))
+			{
+				m_backend = reactor_io_backend::io_uring;
+			}
+
+			m_scheduler->attach(*this);
+		}
+
+		reactor_io(const reactor_io&) = delete;
+		reactor_io& operator=(const reactor_io&) = delete;
+
+		// Buffers of in flight operations may still be written by kernel, they are cancelled and
+		// waited for before the ring is closed. Their coroutines are not resumed anymore.
+		~reactor_io()
+		{
+			m_scheduler->detach(*this);
+
+			if (m_backend == reactor_io_backend::io_uring)
+			{
+				m_ring.cancel_all();
+			}
+		}
+
+		reactor_io_backend backend() const
+		{
+			return m_backend;
+		}
+
+		reactor_io_operation<T, Policies...> read(int fd, void* buffer, std::size_t size, std::uint64_t offset)
+		{
+			return { *this, IORING_OP_READ, fd, buffer, size, offset, 0 };
+		}
+
+		reactor_io_operation<T, Policies...> write(int fd, const void* buffer, std::size_t size, std::uint64_t offset)
+		{
+			return { *this, IORING_OP_WRITE, fd, const_cast<void*>(buffer), size, offset, 0 };
+		}
+
+		reactor_io_operation<T, Policies...> recv(int fd, void* buffer, std::size_t size, int flags = 0)
+		{
+			return { *this, IORING_OP_RECV, fd, buffer, size, 0, flags };
+		}
+
+		reactor_io_operation<T, Policies...> send(int fd, const void* buffer, std::size_t size, int flags = 0)
+		{
+			return { *this, IORING_OP_SEND, fd, const_cast<void*>(buffer), size, 0, flags };
+		}
+
+	private:
+		friend class reactor_io_operation<T, Policies...>;
+
+		void queue(detail::io_operation& operation)
+		{
+			if (m_backend == reactor_io_backend::io_uring && m_pending.empty() && m_ring.can_prepare())
+			{
+				m_ring.prepare(operation);
+			}
+			else
+			{
+				m_pending.push_back(&operation);
+			}
+		}
+
+		void begin_frame() override
+		{
+			if (m_backend == reactor_io_backend::io_uring)
+			{
+				m_ring.reap([this](detail::io_operation& operation, int result)
+				{
+					operation.m_result = result;
+					m_scheduler->enqueue_update(operation.m_node, "reactor_io");
+				});
+			}
+			else
+			{
+				m_scheduler->enqueue_update(m_completed, "reactor_io");
+			}
+		}
+
+		void end_frame() override
+		{
+			if (m_backend == reactor_io_backend::io_uring)
+			{
+				std::size_t prepared = 0;
+				for (; prepared < m_pending.size() && m_ring.can_prepare(); ++prepared)
+				{
+					m_ring.prepare(*m_pending[prepared]);
+				}
+				m_pending.erase(m_pending.begin(), m_pending.begin() + prepared);
+
+				m_ring.submit();
+			}
+			else
+			{
+				std::size_t waiting = 0;
+				for (auto operation : m_pending)
+				{
+					if (perform(*operation))
+					{
+						m_completed.push_back(operation->m_node);
+					}
+					else
+					{
+						m_pending[waiting++] = operation;
+					}
+				}
+				m_pending.resize(waiting);
+			}
+		}
+
+		// False means operation would block and is retried next frame
+		static bool perform(detail::io_operation& operation)
+		{
+			ssize_t result = 0;
+			switch (operation.m_opcode)
+			{
+			case IORING_OP_READ:
+				result = ::pread(operation.m_fd, operation.m_buffer, operation.m_size, static_cast<off_t>(operation.m_offset));
+				break;
+			case IORING_OP_WRITE:
+				result = ::pwrite(operation.m_fd, operation.m_buffer, operation.m_size, static_cast<off_t>(operation.m_offset));
+				break;
+			case IORING_OP_RECV:
+				result = ::recv(operation.m_fd, operation.m_buffer, operation.m_size, operation.m_flags | MSG_DONTWAIT);
+				break;
+			case IORING_OP_SEND:
+				result = ::send(operation.m_fd, operation.m_buffer, operation.m_size, operation.m_flags | MSG_DONTWAIT);
+				break;
+			}
+
+			if (result < 0)
+			{
+				if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+				{
+					return false;
+				}
+				operation.m_result = -errno;
+				return true;
+			}
+
+			operation.m_result = static_cast<int>(result);
+			return true;
+		}
+
+		reactor_scheduler<T, Policies...>* m_scheduler;
+		reactor_io_backend m_backend;
+		detail::io_uring_queue m_ring;
+
+		std::vector<detail::io_operation*> m_pending;
+		reactor_frame_list m_completed;
+	};
+
+	template <class T, class... Policies>
+	class reactor_io_operation
+	{
+	public:
+		static constexpr const char* awaitable_name = "reactor_io";
+
+		reactor_io_operation(reactor_io<T, Policies...>& io, unsigned char opcode, int fd, void* buffer, std::size_t size, std::uint64_t offset, int flags)
+			: m_io(&io)
+		{
+			m_operation.m_opcode = opcode;
+			m_operation.m_fd = fd;
+			m_operation.m_buffer = buffer;
+			m_operation.m_size = static_cast<unsigned>(size);
+			m_operation.m_offset = offset;
+			m_operation.m_flags = flags;
+			m_operation.m_result = 0;
+		}
+
+		bool await_ready() const noexcept
+		{
+			return false;
+		}
+
+		void await_suspend(detail::coro::coroutine_handle<> awaitingCoroutine)
+		{
+			m_operation.m_node.m_handle = awaitingCoroutine;
+			m_io->queue(m_operation);
+		}
+
+		// Number of bytes transfered, errors are thrown same as from coroutines
+		std::size_t await_resume()
+		{
+			if (m_operation.m_result < 0)
+			{
+				throw std::system_error(-m_operation.m_result, std::generic_category());
+			}
+			return static_cast<std::size_t>(m_operation.m_result);
+		}
+
+	private:
+		reactor_io<T, Policies...>* m_io;
+		detail::io_operation m_operation;
+	};
+}
+
+#endif
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef REACTOR_ISOLATION_HPP_INCLUDED
+#define REACTOR_ISOLATION_HPP_INCLUDED
+
+#include "reactor_coroutine.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <vector>
+
+namespace cppcoro
+{
+	struct reactor_coroutine_failure
+	{
+		// Frame address of the coroutine pushed to the scheduler, awaited children fail through it
+		const void* m_coroutine;
+		std::exception_ptr m_exception;
+	};
+
+	// Error policy isolating failures to the coroutine that threw. Exception escaping a pushed
+	// coroutine completes it and is recorded, the rest of the frame is resumed as usual:
+	//
+	//   reactor_scheduler<reactor_default_frame_data, reactor_isolate_errors> scheduler;
+	//   scheduler.update_next_frame();
+	//   for (auto& failure : scheduler.policy<reactor_isolate_errors>().failures())
+	//      log(failure.m_coroutine, failure.m_exception);
+	//
+	// Failed coroutine is done(), its owner releases it as any other. Report keeps its capacity
+	// between frames, so a frame without failures does not allocate.
+	class reactor_isolate_errors : public reactor_error_policy
+	{
+	public:
+		reactor_isolate_errors()
+			: m_frame(0), m_total(0)
+		{
+		}
+
+		reactor_isolate_errors(const reactor_isolate_errors&) = delete;
+		reactor_isolate_errors& operator=(const reactor_isolate_errors&) = delete;
+
+		// Called for every failure right when it is recorded, inside the resume loop
+		void set_failure_callback(std::function<void(const reactor_coroutine_failure& failure)> callback)
+		{
+			m_callback = std::move(callback);
+		}
+
+		// Failures of the latest frame
+		const std::vector<reactor_coroutine_failure>& failures() const
+		{
+			return m_failures;
+		}
+
+		// Frames updated, the latest one included
+		std::uint64_t frame() const
+		{
+			return m_frame;
+		}
+
+		// Failures since the scheduler was created
+		std::size_t total_failures() const
+		{
+			return m_total;
+		}
+
+		void begin_frame()
+		{
+			m_failures.clear();
+			++m_frame;
+		}
+
+		void on_unhandled_exception(const void* coroutine)
+		{
+			m_failures.push_back({ coroutine, std::current_exception() });
+			++m_total;
+			if (m_callback)
+			{
+				m_callback(m_failures.back());
+			}
+		}
+
+	private:
+		std::uint64_t m_frame;
+		std::size_t m_total;
+		std::vector<reactor_coroutine_failure> m_failures;
+		std::function<void(const reactor_coroutine_failure& failure)> m_callback;
+	};
+}
+
+#endif
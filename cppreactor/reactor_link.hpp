@@ -0,0 +1,328 @@
+#ifndef REACTOR_LINK_HPP_INCLUDED
+#define REACTOR_LINK_HPP_INCLUDED
+
+#include "reactor_coroutine.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+
+namespace cppcoro
+{
+	template <class Msg, class T = reactor_default_frame_data, class... Policies>
+	class reactor_link;
+
+	template <class Msg, class T = reactor_default_frame_data, class... Policies>
+	class reactor_link_batch;
+
+	namespace detail
+	{
+		// Keeps producer and consumer indices on separate cache lines
+		constexpr std::size_t link_cache_line = 64;
+	}
+
+	// Messages published by sender since receiver's previous resume, slots are handed back to sender when batch is destroyed.
+	// Only one batch of a link may be alive at a time, destroy it before receiving the next one.
+	template <class Msg, class T, class... Policies>
+	class reactor_link_batch
+	{
+	public:
+		class iterator
+		{
+		public:
+			iterator(const reactor_link<Msg, T, Policies...>* link, std::size_t index)
+				: m_link(link), m_index(index)
+			{
+			}
+
+			Msg& operator*() const
+			{
+				return m_link->slot(m_index);
+			}
+
+			Msg* operator->() const
+			{
+				return &m_link->slot(m_index);
+			}
+
+			iterator& operator++()
+			{
+				++m_index;
+				return *this;
+			}
+
+			bool operator==(const iterator& other) const
+			{
+				return m_index == other.m_index;
+			}
+
+			bool operator!=(const iterator& other) const
+			{
+				return m_index != other.m_index;
+			}
+
+		private:
+			const reactor_link<Msg, T, Policies...>* m_link;
+			std::size_t m_index;
+		};
+
+		reactor_link_batch(reactor_link_batch&& other) noexcept
+			: m_link(other.m_link), m_first(other.m_first), m_last(other.m_last)
+		{
+			other.m_link = nullptr;
+		}
+
+		reactor_link_batch(const reactor_link_batch&) = delete;
+		reactor_link_batch& operator=(const reactor_link_batch&) = delete;
+
+		~reactor_link_batch()
+		{
+			if (m_link)
+			{
+				m_link->release(m_first, m_last);
+			}
+		}
+
+		iterator begin() const
+		{
+			return { m_link, m_first };
+		}
+
+		iterator end() const
+		{
+			return { m_link, m_last };
+		}
+
+		std::size_t size() const
+		{
+			return m_last - m_first;
+		}
+
+		bool empty() const
+		{
+			return m_first == m_last;
+		}
+
+	private:
+		friend class reactor_link<Msg, T, Policies...>;
+
+		reactor_link_batch(reactor_link<Msg, T, Policies...>* link, std::size_t first, std::size_t last)
+			: m_link(link), m_first(first), m_last(last)
+		{
+		}
+
+		reactor_link<Msg, T, Policies...>* m_link;
+		std::size_t m_first;
+		std::size_t m_last;
+	};
+
+	// One way channel between schedulers running on different threads, backed by a lock-free
+	// single producer single consumer ring. Messages sent during a sender frame are published
+	// together at its end, the receiving coroutine is resumed in the next receiver frame.
+	// Create one link per ordered scheduler pair before the schedulers start running.
+	template <class Msg, class T, class... Policies>
+	class reactor_link
+	{
+	public:
+		class receive_awaitable
+		{
+		public:
+			static constexpr const char* awaitable_name = "reactor_link";
+
+			explicit receive_awaitable(reactor_link& link)
+				: m_link(&link)
+			{
+			}
+
+			bool await_ready() const noexcept
+			{
+				return false;
+			}
+
+			void await_suspend(detail::coro::coroutine_handle<> awaitingCoroutine)
+			{
+				assert(!m_link->m_receiver);
+				m_node.m_handle = awaitingCoroutine;
+				m_link->m_receiver = &m_node;
+			}
+
+			reactor_link_batch<Msg, T, Policies...> await_resume()
+			{
+				return m_link->take();
+			}
+
+		private:
+			reactor_link* m_link;
+			reactor_frame_node m_node;
+		};
+
+		// Capacity is rounded up to power of two
+		reactor_link(reactor_scheduler<T, Policies...>& sender, reactor_scheduler<T, Policies...>& receiver, std::size_t capacity = 1024)
+			: m_sender_hook(*this), m_receiver_hook(*this),
+			m_sender(&sender), m_receiver_scheduler(&receiver)
+		{
+			std::size_t size = 1;
+			while (size < capacity)
+			{
+				size <<= 1;
+			}
+			m_mask = size - 1;
+			m_slots.reset(new slot_storage[size]);
+
+			m_tail.store(0, std::memory_order_relaxed);
+			m_head.store(0, std::memory_order_relaxed);
+			m_write = 0;
+			m_cached_head = 0;
+			m_read = 0;
+			m_cached_tail = 0;
+			m_receiver = nullptr;
+			m_batch_alive = false;
+
+			m_sender->attach(m_sender_hook);
+			m_receiver_scheduler->attach(m_receiver_hook);
+		}
+
+		reactor_link(const reactor_link&) = delete;
+		reactor_link& operator=(const reactor_link&) = delete;
+
+		~reactor_link()
+		{
+			// Batch would release its slots into destroyed link
+			assert(!m_batch_alive);
+
+			m_sender->detach(m_sender_hook);
+			m_receiver_scheduler->detach(m_receiver_hook);
+
+			for (std::size_t i = m_head.load(std::memory_order_acquire); i != m_write; ++i)
+			{
+				slot(i).~Msg();
+			}
+		}
+
+		// Sender thread only. False when ring is full, message is then not sent.
+		template <class... Args>
+		bool send(Args&&... args)
+		{
+			if (m_write - m_cached_head > m_mask)
+			{
+				m_cached_head = m_head.load(std::memory_order_acquire);
+				if (m_write - m_cached_head > m_mask)
+				{
+					return false;
+				}
+			}
+
+			new (&m_slots[m_write & m_mask]) Msg(std::forward<Args>(args)...);
+			++m_write;
+			return true;
+		}
+
+		// Receiver thread only
+		receive_awaitable receive_batch()
+		{
+			return receive_awaitable{ *this };
+		}
+
+		std::size_t capacity() const
+		{
+			return m_mask + 1;
+		}
+
+	private:
+		friend class reactor_link_batch<Msg, T, Policies...>;
+		friend class reactor_link_batch<Msg, T, Policies...>::iterator;
+
+		typedef typename std::aligned_storage<sizeof(Msg), alignof(Msg)>::type slot_storage;
+
+		struct sender_hook : reactor_frame_hook
+		{
+			explicit sender_hook(reactor_link& link)
+				: m_link(&link)
+			{
+			}
+
+			// Everything sent this frame becomes visible to receiver at once
+			void end_frame() override
+			{
+				m_link->m_tail.store(m_link->m_write, std::memory_order_release);
+			}
+
+			reactor_link* m_link;
+		};
+
+		struct receiver_hook : reactor_frame_hook
+		{
+			explicit receiver_hook(reactor_link& link)
+				: m_link(&link)
+			{
+			}
+
+			void begin_frame() override
+			{
+				auto& link = *m_link;
+				if (!link.m_receiver)
+				{
+					return;
+				}
+
+				link.m_cached_tail = link.m_tail.load(std::memory_order_acquire);
+				if (link.m_cached_tail != link.m_read)
+				{
+					link.m_receiver_scheduler->enqueue_update(*link.m_receiver, "reactor_link");
+					link.m_receiver = nullptr;
+				}
+			}
+
+			reactor_link* m_link;
+		};
+
+		Msg& slot(std::size_t index) const
+		{
+			return *reinterpret_cast<Msg*>(&m_slots[index & m_mask]);
+		}
+
+		reactor_link_batch<Msg, T, Policies...> take()
+		{
+			// Releasing batches out of order would hand slots still being read back to sender
+			assert(!m_batch_alive);
+			m_batch_alive = true;
+
+			std::size_t first = m_read;
+			m_read = m_cached_tail;
+			return { this, first, m_read };
+		}
+
+		void release(std::size_t first, std::size_t last)
+		{
+			for (std::size_t i = first; i != last; ++i)
+			{
+				slot(i).~Msg();
+			}
+			m_head.store(last, std::memory_order_release);
+			m_batch_alive = false;
+		}
+
+		sender_hook m_sender_hook;
+		receiver_hook m_receiver_hook;
+		reactor_scheduler<T, Policies...>* m_sender;
+		reactor_scheduler<T, Policies...>* m_receiver_scheduler;
+		std::unique_ptr<slot_storage[]> m_slots;
+		std::size_t m_mask;
+
+		// Sender side
+		alignas(detail::link_cache_line) std::atomic<std::size_t> m_tail;
+		std::size_t m_write;
+		std::size_t m_cached_head;
+
+		// Receiver side
+		alignas(detail::link_cache_line) std::atomic<std::size_t> m_head;
+		std::size_t m_read;
+		std::size_t m_cached_tail;
+		reactor_frame_node* m_receiver;
+		bool m_batch_alive;
+	};
+}
+
+#endif
@@ -0,0 +1,217 @@
+#ifndef REACTOR_REALTIME_HPP_INCLUDED
+#define REACTOR_REALTIME_HPP_INCLUDED
+
+#include "reactor_coroutine.hpp"
+
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <new>
+
+namespace cppcoro
+{
+	// Fixed number of equally sized coroutine frames allocated at once. Allocation and release are
+	// a free list pop and push, a frame over the size or over the capacity is counted and refused.
+	class reactor_frame_pool
+	{
+	public:
+		reactor_frame_pool()
+			: m_free(nullptr), m_frame_size(0), m_capacity(0), m_in_use(0), m_peak(0), m_allocations(0), m_overflows(0)
+		{
+		}
+
+		reactor_frame_pool(std::size_t frame_size, std::size_t capacity)
+			: reactor_frame_pool()
+		{
+			// Every frame keeps the alignment global operator new would give it
+			const std::size_t alignment = alignof(std::max_align_t);
+			frame_size = frame_size < sizeof(free_frame) ? sizeof(free_frame) : frame_size;
+			m_frame_size = (frame_size + alignment - 1) / alignment * alignment;
+			m_capacity = capacity;
+			m_frames.reset(new unsigned char[m_frame_size * m_capacity]);
+
+			// Frames are handed out from the start of the block
+			for (std::size_t i = m_capacity; i > 0; i--)
+			{
+				auto frame = reinterpret_cast<free_frame*>(m_frames.get() + (i - 1) * m_frame_size);
+				frame->m_next = m_free;
+				m_free = frame;
+			}
+		}
+
+		reactor_frame_pool(reactor_frame_pool&&) = default;
+		reactor_frame_pool& operator=(reactor_frame_pool&&) = default;
+
+		// Null when size is over frame size or all frames are in use
+		void* allocate(std::size_t size) noexcept
+		{
+			if (size > m_frame_size || !m_free)
+			{
+				++m_overflows;
+				return nullptr;
+			}
+
+			auto frame = m_free;
+			m_free = frame->m_next;
+			++m_allocations;
+			if (++m_in_use > m_peak)
+			{
+				m_peak = m_in_use;
+			}
+			return frame;
+		}
+
+		void deallocate(void* memory) noexcept
+		{
+			auto frame = static_cast<free_frame*>(memory);
+			frame->m_next = m_free;
+			m_free = frame;
+			--m_in_use;
+		}
+
+		std::size_t frame_size() const
+		{
+			return m_frame_size;
+		}
+
+		std::size_t capacity() const
+		{
+			return m_capacity;
+		}
+
+		std::size_t in_use() const
+		{
+			return m_in_use;
+		}
+
+		// Most frames in use at once
+		std::size_t peak() const
+		{
+			return m_peak;
+		}
+
+		std::size_t allocations() const
+		{
+			return m_allocations;
+		}
+
+		// Refused allocations
+		std::size_t overflows() const
+		{
+			return m_overflows;
+		}
+
+	private:
+		struct free_frame
+		{
+			free_frame* m_next;
+		};
+
+		std::unique_ptr<unsigned char[]> m_frames;
+		free_frame* m_free;
+		std::size_t m_frame_size;
+		std::size_t m_capacity;
+		std::size_t m_in_use;
+		std::size_t m_peak;
+		std::size_t m_allocations;
+		std::size_t m_overflows;
+	};
+
+	struct reactor_realtime_counters
+	{
+		std::size_t m_frame_size;
+		std::size_t m_frame_capacity;
+		std::size_t m_frames_in_use;
+		std::size_t m_frame_peak;
+		std::size_t m_frame_allocations;
+		std::size_t m_frame_overflows;
+	};
+
+	// Frame allocator policy taking coroutine frames from a pool of the calling thread. Coroutines have
+	// to be created and released on the thread that reserved it, a frame that does not fit in the
+	// pool is counted and the coroutine call throws std::bad_alloc.
+	class reactor_pooled_frames : public reactor_frame_allocator
+	{
+	public:
+		// Frame pool of the calling thread, empty until reserve_frames
+		static reactor_frame_pool& frame_pool()
+		{
+			thread_local reactor_frame_pool pool;
+			return pool;
+		}
+
+		// Replaces frame pool of the calling thread, none of its frames can be in use
+		static void reserve_frames(std::size_t frame_size, std::size_t capacity)
+		{
+			assert(frame_pool().in_use() == 0);
+			frame_pool() = reactor_frame_pool(frame_size, capacity);
+		}
+
+		// Frees frame pool of the calling thread, none of its frames can be in use
+		static void release_frames()
+		{
+			assert(frame_pool().in_use() == 0);
+			frame_pool() = reactor_frame_pool();
+		}
+
+		static void* allocate_frame(std::size_t size)
+		{
+			if (auto frame = frame_pool().allocate(size))
+			{
+				return frame;
+			}
+			throw std::bad_alloc();
+		}
+
+		static void deallocate_frame(void* frame, std::size_t) noexcept
+		{
+			frame_pool().deallocate(frame);
+		}
+	};
+
+	// Fixed capacity policy for soft real-time loops, nothing is allocated once the scheduler and
+	// frame pool are sized at startup:
+	//
+	//   reactor_realtime::reserve_frames(512, 10000);
+	//   reactor_scheduler<reactor_default_frame_data, reactor_realtime> scheduler;
+	//   scheduler.reserve(10000);
+	//
+	// A handle that does not fit in the frame queue would leave its coroutine suspended for good,
+	// the callback gets the source that queued it and the process is then terminated. Size the
+	// queues for the worst frame. Frames come from reactor_pooled_frames.
+	class reactor_realtime : public reactor_fixed_capacity, public reactor_pooled_frames
+	{
+	public:
+		reactor_realtime() = default;
+
+		reactor_realtime(const reactor_realtime&) = delete;
+		reactor_realtime& operator=(const reactor_realtime&) = delete;
+
+		void set_overflow_callback(std::function<void(const char* source)> callback)
+		{
+			m_callback = std::move(callback);
+		}
+
+		// Frame pool state of the calling thread
+		reactor_realtime_counters counters() const
+		{
+			auto& pool = frame_pool();
+			return { pool.frame_size(), pool.capacity(), pool.in_use(), pool.peak(), pool.allocations(), pool.overflows() };
+		}
+
+		// Last call before the scheduler terminates the process
+		void on_queue_overflow(const char* source)
+		{
+			if (m_callback)
+			{
+				m_callback(source);
+			}
+		}
+
+	private:
+		std::function<void(const char* source)> m_callback;
+	};
+}
+
+#endif
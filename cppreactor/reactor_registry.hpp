@@ -0,0 +1,222 @@
+#ifndef REACTOR_REGISTRY_HPP_INCLUDED
+#define REACTOR_REGISTRY_HPP_INCLUDED
+
+#include "reactor_coroutine.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace cppcoro
+{
+	// Stable handle of a registered coroutine. Slots are reused, the generation tells a reused slot
+	// apart, so an id of a destroyed coroutine never addresses another one.
+	struct reactor_coroutine_id
+	{
+		std::uint32_t m_index = 0;
+		std::uint32_t m_generation = 0;
+
+		bool operator==(const reactor_coroutine_id& other) const
+		{
+			return m_index == other.m_index && m_generation == other.m_generation;
+		}
+
+		bool operator!=(const reactor_coroutine_id& other) const
+		{
+			return !(*this == other);
+		}
+	};
+
+	enum class reactor_coroutine_state : std::uint8_t
+	{
+		free,
+		scheduled, // Pushed or awaited, not started yet
+		running,
+		suspended,
+		completed
+	};
+
+	// Instrumentation policy registering every pushed or awaited coroutine in a generational slot
+	// map. Hot metadata lives in separate arrays indexed by slot, outside of coroutine frames, so
+	// counting, enumeration and filtering are sequential scans:
+	//
+	//   auto& registry = scheduler.instrumentation<reactor_registry>();
+	//   auto id = registry.id_of(coroutine);
+	//   registry.set_priority(id, 10);
+	//   registry.for_each([&](reactor_coroutine_id id) { ... });
+	class reactor_registry : public reactor_instrumentation
+	{
+	public:
+		static constexpr std::size_t state_count = 5;
+
+		struct coroutine_data
+		{
+			reactor_coroutine_id m_id;
+		};
+
+		reactor_registry()
+			: m_frame(0), m_size(0)
+		{
+		}
+
+		reactor_registry(const reactor_registry&) = delete;
+		reactor_registry& operator=(const reactor_registry&) = delete;
+
+		// Id of a coroutine that was pushed or awaited
+		template <class Coroutine>
+		static reactor_coroutine_id id_of(const Coroutine& coroutine)
+		{
+			return coroutine.template instrumentation_data<reactor_registry>().m_id;
+		}
+
+		bool contains(reactor_coroutine_id id) const
+		{
+			return id.m_index < m_generations.size() && m_generations[id.m_index] == id.m_generation
+				&& m_states[id.m_index] != reactor_coroutine_state::free;
+		}
+
+		std::size_t size() const
+		{
+			return m_size;
+		}
+
+		// Coroutine frame address, null when id does not exist anymore
+		const void* address(reactor_coroutine_id id) const
+		{
+			return contains(id) ? m_coroutines[id.m_index] : nullptr;
+		}
+
+		reactor_coroutine_state state(reactor_coroutine_id id) const
+		{
+			return contains(id) ? m_states[id.m_index] : reactor_coroutine_state::free;
+		}
+
+		// Frame of the latest resume, 0 before the first one
+		std::uint64_t resume_frame(reactor_coroutine_id id) const
+		{
+			return contains(id) ? m_resume_frames[id.m_index] : 0;
+		}
+
+		int priority(reactor_coroutine_id id) const
+		{
+			return contains(id) ? m_priorities[id.m_index] : 0;
+		}
+
+		// False when id does not exist anymore
+		bool set_priority(reactor_coroutine_id id, int priority)
+		{
+			if (!contains(id))
+			{
+				return false;
+			}
+			m_priorities[id.m_index] = priority;
+			return true;
+		}
+
+		// Calls f with id of every registered coroutine
+		template <class F>
+		void for_each(F&& f) const
+		{
+			for (std::uint32_t i = 0; i < m_states.size(); i++)
+			{
+				if (m_states[i] != reactor_coroutine_state::free)
+				{
+					f(reactor_coroutine_id{ i, m_generations[i] });
+				}
+			}
+		}
+
+		// Registered coroutines per reactor_coroutine_state
+		std::array<std::size_t, state_count> count_by_state() const
+		{
+			std::array<std::size_t, state_count> counts{};
+			for (auto state : m_states)
+			{
+				++counts[static_cast<std::size_t>(state)];
+			}
+			return counts;
+		}
+
+		// Coroutines that were not resumed for more than given number of frames
+		template <class F>
+		void for_each_idle(std::uint64_t frames, F&& f) const
+		{
+			for (std::uint32_t i = 0; i < m_states.size(); i++)
+			{
+				if (m_states[i] != reactor_coroutine_state::free && m_frame - m_resume_frames[i] > frames)
+				{
+					f(reactor_coroutine_id{ i, m_generations[i] });
+				}
+			}
+		}
+
+		void begin_frame()
+		{
+			++m_frame;
+		}
+
+		void on_schedule(coroutine_data& data, const void* address)
+		{
+			std::uint32_t index;
+			if (m_free.empty())
+			{
+				index = static_cast<std::uint32_t>(m_states.size());
+				m_generations.push_back(0);
+				m_states.push_back(reactor_coroutine_state::free);
+				m_resume_frames.push_back(0);
+				m_priorities.push_back(0);
+				m_coroutines.push_back(nullptr);
+			}
+			else
+			{
+				index = m_free.back();
+				m_free.pop_back();
+			}
+
+			m_states[index] = reactor_coroutine_state::scheduled;
+			m_resume_frames[index] = m_frame;
+			m_priorities[index] = 0;
+			m_coroutines[index] = address;
+			data.m_id = { index, m_generations[index] };
+			++m_size;
+		}
+
+		void on_resume(coroutine_data& data, bool)
+		{
+			m_states[data.m_id.m_index] = reactor_coroutine_state::running;
+			m_resume_frames[data.m_id.m_index] = m_frame;
+		}
+
+		void on_await(coroutine_data& data, const char* awaitable)
+		{
+			m_states[data.m_id.m_index] = awaitable == completed_awaitable
+				? reactor_coroutine_state::completed : reactor_coroutine_state::suspended;
+		}
+
+		void on_destroy(coroutine_data& data)
+		{
+			auto index = data.m_id.m_index;
+			m_states[index] = reactor_coroutine_state::free;
+			m_coroutines[index] = nullptr;
+			++m_generations[index];
+			m_free.push_back(index);
+			--m_size;
+		}
+
+	private:
+		std::uint64_t m_frame;
+		std::size_t m_size;
+
+		// Structure of arrays indexed by slot
+		std::vector<std::uint32_t> m_generations;
+		std::vector<reactor_coroutine_state> m_states;
+		std::vector<std::uint64_t> m_resume_frames;
+		std::vector<int> m_priorities;
+		std::vector<const void*> m_coroutines;
+
+		std::vector<std::uint32_t> m_free;
+	};
+}
+
+#endif
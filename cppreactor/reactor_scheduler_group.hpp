@@ -0,0 +1,190 @@
+#ifndef REACTOR_SCHEDULER_GROUP_HPP_INCLUDED
+#define REACTOR_SCHEDULER_GROUP_HPP_INCLUDED
+
+#include "reactor_coroutine.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#elif defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
+
+namespace cppcoro
+{
+	namespace detail
+	{
+		// Reusable spinning barrier, threads yield while waiting so oversubscribed cores still progress
+		class frame_barrier
+		{
+		public:
+			explicit frame_barrier(std::size_t count)
+				: m_count(count), m_waiting(0), m_generation(0)
+			{
+			}
+
+			void arrive_and_wait()
+			{
+				auto generation = m_generation.load(std::memory_order_acquire);
+				if (m_waiting.fetch_add(1, std::memory_order_acq_rel) + 1 == m_count)
+				{
+					m_waiting.store(0, std::memory_order_relaxed);
+					m_generation.store(generation + 1, std::memory_order_release);
+					return;
+				}
+
+				while (m_generation.load(std::memory_order_acquire) == generation)
+				{
+					std::this_thread::yield();
+				}
+			}
+
+		private:
+			const std::size_t m_count;
+			std::atomic<std::size_t> m_waiting;
+			std::atomic<std::uint64_t> m_generation;
+		};
+
+		inline void pin_thread(std::thread& thread, std::size_t index)
+		{
+			unsigned cores = std::thread::hardware_concurrency();
+			if (cores == 0)
+			{
+				return;
+			}
+
+#if defined(__linux__)
+			cpu_set_t set;
+			CPU_ZERO(&set);
+			CPU_SET(index % cores, &set);
+			pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+#elif defined(_WIN32)
+			SetThreadAffinityMask(thread.native_handle(), DWORD_PTR(1) << (index % cores));
+#endif
+		}
+	}
+
+	// Runs N schedulers side by side, each on its own pinned thread. Every update_next_frame call
+	// ticks all of them once with the same frame data and returns after all finished the frame.
+	// Schedulers may only be accessed from outside (push, attach...) between frames.
+	template <class T = reactor_default_frame_data, class... Policies>
+	class reactor_scheduler_group
+	{
+	public:
+		explicit reactor_scheduler_group(std::size_t count, bool pin_threads = true)
+			: m_barrier(count + 1), m_frame(0), m_stop(false), m_exceptions(count)
+		{
+			for (std::size_t i = 0; i < count; i++)
+			{
+				m_schedulers.emplace_back(new reactor_scheduler<T, Policies...>());
+			}
+
+			for (std::size_t i = 0; i < count; i++)
+			{
+				m_threads.emplace_back([this, i] { run(i); });
+				if (pin_threads)
+				{
+					detail::pin_thread(m_threads.back(), i);
+				}
+			}
+		}
+
+		reactor_scheduler_group(const reactor_scheduler_group&) = delete;
+		reactor_scheduler_group& operator=(const reactor_scheduler_group&) = delete;
+
+		~reactor_scheduler_group()
+		{
+			m_stop.store(true, std::memory_order_relaxed);
+			m_barrier.arrive_and_wait();
+
+			for (auto& thread : m_threads)
+			{
+				thread.join();
+			}
+		}
+
+		std::size_t size() const
+		{
+			return m_schedulers.size();
+		}
+
+		reactor_scheduler<T, Policies...>& operator[](std::size_t index)
+		{
+			return *m_schedulers[index];
+		}
+
+		// Frames completed by the whole group
+		std::uint64_t frame() const
+		{
+			return m_frame.load(std::memory_order_acquire);
+		}
+
+		void update_next_frame(T reactor_default_frame_data = T())
+		{
+			m_frame_data.set(reactor_default_frame_data);
+
+			// Start and end of frame, barrier orders frame data and scheduler state between threads
+			m_barrier.arrive_and_wait();
+			m_barrier.arrive_and_wait();
+
+			m_frame.fetch_add(1, std::memory_order_release);
+
+			for (auto& exception : m_exceptions)
+			{
+				if (exception)
+				{
+					auto rethrown = exception;
+					exception = nullptr;
+					std::rethrow_exception(rethrown);
+				}
+			}
+		}
+
+	private:
+		void run(std::size_t index)
+		{
+			auto& scheduler = *m_schedulers[index];
+			for (;;)
+			{
+				m_barrier.arrive_and_wait();
+				if (m_stop.load(std::memory_order_relaxed))
+				{
+					return;
+				}
+
+				try
+				{
+					scheduler.update_next_frame(m_frame_data.get());
+				}
+				catch (...)
+				{
+					m_exceptions[index] = std::current_exception();
+				}
+
+				m_barrier.arrive_and_wait();
+			}
+		}
+
+		detail::frame_barrier m_barrier;
+		std::atomic<std::uint64_t> m_frame;
+		std::atomic<bool> m_stop;
+		REACTOR_NO_UNIQUE_ADDRESS detail::reference_to_pointer<T> m_frame_data;
+
+		std::vector<std::unique_ptr<reactor_scheduler<T, Policies...> > > m_schedulers;
+		std::vector<std::exception_ptr> m_exceptions;
+		std::vector<std::thread> m_threads;
+	};
+}
+
+#endif
@@ -0,0 +1,153 @@
+#ifndef REACTOR_STATS_HPP_INCLUDED
+#define REACTOR_STATS_HPP_INCLUDED
+
+#include "reactor_coroutine.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace cppcoro
+{
+	// Snapshot of a single live coroutine
+	struct reactor_coroutine_stats
+	{
+		// Coroutine frame address, stable while the coroutine is alive
+		const void* m_coroutine;
+		std::uint64_t m_resumes;
+		std::chrono::nanoseconds m_total_resume_time;
+		std::chrono::nanoseconds m_max_resume_time;
+		std::uint64_t m_frames_alive;
+		std::uint64_t m_frames_waiting_on_children;
+	};
+
+	// Instrumentation policy measuring which coroutines use the frame budget. Every resume is timed
+	// from the moment the coroutine gets control until it awaits again, time spent in awaited children
+	// is accounted to the children. Enabled by listing it in scheduler and coroutine types:
+	//
+	//   reactor_scheduler<reactor_default_frame_data, reactor_stats> scheduler;
+	//   reactor_coroutine<reactor_default_frame_data, reactor_stats> coroutine = ...;
+	class reactor_stats : public reactor_instrumentation
+	{
+	public:
+		typedef std::chrono::steady_clock clock;
+
+		struct coroutine_data
+		{
+			coroutine_data* m_previous = nullptr;
+			coroutine_data* m_next = nullptr;
+			const void* m_coroutine = nullptr;
+
+			std::uint64_t m_resumes = 0;
+			clock::duration m_total_resume_time{};
+			clock::duration m_max_resume_time{};
+			clock::time_point m_resumed_at;
+
+			std::uint64_t m_created_frame = 0;
+			std::uint64_t m_child_awaited_frame = 0;
+			std::uint64_t m_frames_waiting_on_children = 0;
+		};
+
+		reactor_stats()
+			: m_frame(0), m_live(nullptr)
+		{
+		}
+
+		reactor_stats(const reactor_stats&) = delete;
+		reactor_stats& operator=(const reactor_stats&) = delete;
+
+		void begin_frame()
+		{
+			++m_frame;
+		}
+
+		void on_schedule(coroutine_data& data, const void* address)
+		{
+			data.m_coroutine = address;
+			data.m_created_frame = m_frame;
+
+			data.m_next = m_live;
+			if (m_live)
+			{
+				m_live->m_previous = &data;
+			}
+			m_live = &data;
+		}
+
+		void on_resume(coroutine_data& data, bool child)
+		{
+			if (child)
+			{
+				data.m_frames_waiting_on_children += m_frame - data.m_child_awaited_frame;
+			}
+			data.m_resumed_at = clock::now();
+		}
+
+		void on_suspend(coroutine_data& data, bool child)
+		{
+			auto duration = clock::now() - data.m_resumed_at;
+			++data.m_resumes;
+			data.m_total_resume_time += duration;
+			data.m_max_resume_time = std::max(data.m_max_resume_time, duration);
+
+			if (child)
+			{
+				data.m_child_awaited_frame = m_frame;
+			}
+		}
+
+		void on_destroy(coroutine_data& data)
+		{
+			if (data.m_previous)
+			{
+				data.m_previous->m_next = data.m_next;
+			}
+			else
+			{
+				m_live = data.m_next;
+			}
+
+			if (data.m_next)
+			{
+				data.m_next->m_previous = data.m_previous;
+			}
+		}
+
+		// Frames started since the scheduler was created
+		std::uint64_t frame() const
+		{
+			return m_frame;
+		}
+
+		// Live coroutines sorted by total resume time, at most top entries
+		std::vector<reactor_coroutine_stats> snapshot(std::size_t top = 10) const
+		{
+			std::vector<reactor_coroutine_stats> stats;
+			for (auto data = m_live; data; data = data->m_next)
+			{
+				stats.push_back({ data->m_coroutine, data->m_resumes,
+					std::chrono::duration_cast<std::chrono::nanoseconds>(data->m_total_resume_time),
+					std::chrono::duration_cast<std::chrono::nanoseconds>(data->m_max_resume_time),
+					m_frame - data->m_created_frame, data->m_frames_waiting_on_children });
+			}
+
+			auto by_total_time = [](const reactor_coroutine_stats& a, const reactor_coroutine_stats& b)
+			{
+				return a.m_total_resume_time > b.m_total_resume_time;
+			};
+
+			top = std::min(top, stats.size());
+			std::partial_sort(stats.begin(), stats.begin() + top, stats.end(), by_total_time);
+			stats.resize(top);
+			return stats;
+		}
+
+	private:
+		std::uint64_t m_frame;
+		coroutine_data* m_live;
+	};
+}
+
+#endif
@@ -0,0 +1,224 @@
+#ifndef REACTOR_STREAM_FILE_HPP_INCLUDED
+#define REACTOR_STREAM_FILE_HPP_INCLUDED
+
+#include "reactor_coroutine.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cerrno>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#if __has_include(<span>)
+#include <span>
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define REACTOR_STREAM_FILE_MMAP
+#endif
+
+namespace cppcoro
+{
+	class reactor_file_buffer;
+
+	template <class T = reactor_default_frame_data, class... Policies>
+	reactor_coroutine_return<reactor_file_buffer, T, Policies...> stream_file(std::string path, std::size_t bytes_per_frame);
+
+	namespace detail
+	{
+		struct file_storage
+		{
+			file_storage()
+				: m_data(nullptr), m_size(0), m_mapping(nullptr), m_mapping_size(0)
+			{
+			}
+
+			file_storage(const file_storage&) = delete;
+			file_storage& operator=(const file_storage&) = delete;
+
+			~file_storage()
+			{
+#ifdef REACTOR_STREAM_FILE_MMAP
+				if (m_mapping)
+				{
+					::munmap(m_mapping, m_mapping_size);
+				}
+#endif
+			}
+
+			const char* m_data;
+			std::size_t m_size;
+
+			// Either file is mapped or it was copied into bytes
+			void* m_mapping;
+			std::size_t m_mapping_size;
+			std::vector<char> m_bytes;
+		};
+	}
+
+	// Contents of a file loaded by stream_file, cheap to copy since storage is shared
+	class reactor_file_buffer
+	{
+	public:
+		reactor_file_buffer() noexcept
+		{
+		}
+
+		const char* data() const noexcept
+		{
+			return m_storage ? m_storage->m_data : nullptr;
+		}
+
+		std::size_t size() const noexcept
+		{
+			return m_storage ? m_storage->m_size : 0;
+		}
+
+		bool empty() const noexcept
+		{
+			return size() == 0;
+		}
+
+		// True when data points directly into the memory mapped file, without any copy
+		bool is_mapped() const noexcept
+		{
+			return m_storage && m_storage->m_mapping != nullptr;
+		}
+
+#if __has_include(<span>)
+		// Zero-copy view, valid for as long as any copy of this buffer is alive
+		std::span<const char> span() const noexcept
+		{
+			return { data(), size() };
+		}
+#endif
+
+	private:
+		template <class T, class... Policies>
+		friend reactor_coroutine_return<reactor_file_buffer, T, Policies...> stream_file(std::string path, std::size_t bytes_per_frame);
+
+		std::shared_ptr<detail::file_storage> m_storage;
+	};
+
+	// Loads file over multiple frames, touching or copying at most bytes_per_frame each frame.
+	// Mapped files are returned without a copy, others are read in chunks into the buffer.
+	template <class T, class... Policies>
+	reactor_coroutine_return<reactor_file_buffer, T, Policies...> stream_file(std::string path, std::size_t bytes_per_frame)
+	{
+		assert(bytes_per_frame > 0);
+
+		reactor_file_buffer buffer;
+		buffer.m_storage = std::make_shared<detail::file_storage>();
+		auto& storage = *buffer.m_storage;
+
+#ifdef REACTOR_STREAM_FILE_MMAP
+		int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (fd < 0)
+		{
+			throw std::system_error(errno, std::generic_category(), path);
+		}
+
+		struct stat info;
+		void* mapping = MAP_FAILED;
+		if (::fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0)
+		{
+			mapping = ::mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+		}
+		::close(fd);
+
+		if (mapping != MAP_FAILED)
+		{
+			storage.m_mapping = mapping;
+			storage.m_mapping_size = static_cast<std::size_t>(info.st_size);
+			storage.m_data = static_cast<const char*>(mapping);
+			storage.m_size = storage.m_mapping_size;
+
+			const std::size_t page_size = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+			const char* data = storage.m_data;
+
+			for (std::size_t offset = 0; offset < storage.m_size; )
+			{
+				std::size_t chunk = std::min(bytes_per_frame, storage.m_size - offset);
+
+				// Kernel starts reading next chunk while we fault in the current one
+				std::size_t next = offset + chunk;
+				if (next < storage.m_size)
+				{
+					std::size_t aligned = next & ~(page_size - 1);
+					::madvise(const_cast<char*>(data) + aligned, std::min(bytes_per_frame, storage.m_size - aligned), MADV_WILLNEED);
+				}
+
+				for (std::size_t page = offset; page < next; page += page_size)
+				{
+					(void)static_cast<const volatile char*>(data)[page];
+				}
+
+				offset = next;
+				if (offset < storage.m_size)
+				{
+					co_await next_frame<T>{};
+				}
+			}
+
+			co_return buffer;
+		}
+#endif
+
+		// Non regular files and platforms without mmap are copied in chunks
+		std::unique_ptr<std::FILE, int(*)(std::FILE*)> file(std::fopen(path.c_str(), "rb"), &std::fclose);
+		if (!file)
+		{
+			throw std::system_error(errno, std::generic_category(), path);
+		}
+
+		// Reserve up front when size is known, so growing never copies already read chunks
+		auto& bytes = storage.m_bytes;
+		if (std::fseek(file.get(), 0, SEEK_END) == 0)
+		{
+			long size = std::ftell(file.get());
+			if (size > 0)
+			{
+				bytes.reserve(static_cast<std::size_t>(size) + 1);
+			}
+			std::fseek(file.get(), 0, SEEK_SET);
+		}
+
+		for (;;)
+		{
+			std::size_t offset = bytes.size();
+			std::size_t chunk = bytes_per_frame;
+			if (bytes.capacity() > offset)
+			{
+				chunk = std::min(chunk, bytes.capacity() - offset);
+			}
+
+			bytes.resize(offset + chunk);
+			std::size_t read = std::fread(bytes.data() + offset, 1, chunk, file.get());
+			bytes.resize(offset + read);
+
+			if (read < chunk)
+			{
+				if (std::ferror(file.get()))
+				{
+					throw std::system_error(EIO, std::generic_category(), path);
+				}
+				break;
+			}
+
+			co_await next_frame<T>{};
+		}
+
+		storage.m_data = bytes.data();
+		storage.m_size = bytes.size();
+		co_return buffer;
+	}
+}
+
+#endif
@@ -0,0 +1,264 @@
+#ifndef REACTOR_TRACE_HPP_INCLUDED
+#define REACTOR_TRACE_HPP_INCLUDED
+
+#include "reactor_coroutine.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define REACTOR_TRACE_TSC
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define REACTOR_TRACE_TSC
+#endif
+
+namespace cppcoro
+{
+	namespace detail
+	{
+		// Timestamp counter where available, a clock call would be most of the event cost.
+		// Ticks are converted to nanoseconds against steady clock when the trace is written.
+		inline std::uint64_t trace_ticks()
+		{
+#if defined(REACTOR_TRACE_TSC)
+			return __rdtsc();
+#else
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+		}
+
+		enum class trace_event_type : std::uint32_t
+		{
+			frame_begin,
+			frame_end,
+			resume,
+			suspend
+		};
+
+		struct trace_event
+		{
+			std::uint64_t m_ticks;
+			std::uint64_t m_frame;
+			std::uint32_t m_coroutine;
+			std::uint32_t m_parent;
+			trace_event_type m_type;
+		};
+	}
+
+	// Instrumentation policy recording every frame, resume and suspend into a ring buffer owned by
+	// the scheduler. A scheduler runs on a single thread, so recording needs no locks or atomics.
+	// When the ring is full the oldest events are overwritten. Read it between frames:
+	//
+	//   reactor_scheduler<reactor_default_frame_data, reactor_trace> scheduler;
+	//   ...
+	//   scheduler.instrumentation<reactor_trace>().write_chrome_trace(file);
+	//
+	// Output is Chrome trace-event JSON that chrome://tracing and Perfetto open. Coroutine ids start
+	// at 1, parent is the id of the coroutine awaiting it or 0 for coroutines pushed to the scheduler.
+	// Reading the timestamp counter is most of an event, so a resume right after a suspend reuses its
+	// timestamp, the scheduler's own work between them is counted to the resumed coroutine.
+	class reactor_trace : public reactor_instrumentation
+	{
+	public:
+		typedef std::chrono::steady_clock clock;
+
+		struct coroutine_data
+		{
+			std::uint32_t m_id = 0;
+			std::uint32_t m_parent = 0;
+		};
+
+		explicit reactor_trace(std::size_t capacity = 1 << 16)
+			: m_start(clock::now()), m_start_ticks(detail::trace_ticks()), m_frame(0), m_suspend_ticks(0), m_next_id(1), m_awaiting_parent(0),
+			m_suspended(false), m_enabled(true)
+		{
+			set_capacity(capacity);
+		}
+
+		reactor_trace(const reactor_trace&) = delete;
+		reactor_trace& operator=(const reactor_trace&) = delete;
+
+		// Capacity is rounded up to power of two, recorded events are dropped
+		void set_capacity(std::size_t capacity)
+		{
+			std::size_t size = 1;
+			while (size < capacity)
+			{
+				size <<= 1;
+			}
+			m_events.reset(new detail::trace_event[size]);
+			m_mask = size - 1;
+			m_written = 0;
+		}
+
+		void set_enabled(bool enabled)
+		{
+			m_enabled = enabled;
+		}
+
+		void clear()
+		{
+			m_written = 0;
+		}
+
+		// Events currently held by the ring
+		std::size_t size() const
+		{
+			return m_written < m_mask + 1 ? std::size_t(m_written) : m_mask + 1;
+		}
+
+		// Events overwritten since last clear
+		std::uint64_t dropped() const
+		{
+			return m_written - size();
+		}
+
+		void begin_frame()
+		{
+			++m_frame;
+			m_suspended = false;
+			if (m_enabled)
+			{
+				record(detail::trace_event_type::frame_begin, 0, 0, detail::trace_ticks());
+			}
+		}
+
+		void end_frame()
+		{
+			m_suspended = false;
+			if (m_enabled)
+			{
+				record(detail::trace_event_type::frame_end, 0, 0, detail::trace_ticks());
+			}
+		}
+
+		void on_schedule(coroutine_data& data, const void*)
+		{
+			data.m_id = m_next_id++;
+			data.m_parent = m_awaiting_parent;
+			m_awaiting_parent = 0;
+		}
+
+		void on_resume(coroutine_data& data, bool)
+		{
+			if (m_enabled)
+			{
+				record(detail::trace_event_type::resume, data.m_id, data.m_parent, m_suspended ? m_suspend_ticks : detail::trace_ticks());
+			}
+			m_suspended = false;
+		}
+
+		void on_suspend(coroutine_data& data, bool child)
+		{
+			if (m_enabled)
+			{
+				m_suspend_ticks = detail::trace_ticks();
+				m_suspended = true;
+				record(detail::trace_event_type::suspend, data.m_id, data.m_parent, m_suspend_ticks);
+			}
+
+			// Child is scheduled right after its awaiter suspends
+			if (child)
+			{
+				m_awaiting_parent = data.m_id;
+			}
+		}
+
+		// Writes held events as a Chrome trace, thread id tells schedulers apart in merged traces
+		void write_chrome_trace(std::ostream& out, int thread = 0) const
+		{
+			out << "{\"traceEvents\":[\n";
+			write_chrome_events(out, thread, true);
+			out << "\n]}\n";
+		}
+
+		// Writes events without surrounding object, returns false if nothing was written
+		bool write_chrome_events(std::ostream& out, int thread, bool first) const
+		{
+			auto count = size();
+			auto ns_per_tick = nanoseconds_per_tick();
+			for (std::uint64_t i = m_written - count; i != m_written; ++i)
+			{
+				auto& event = m_events[i & m_mask];
+				out << (first ? "" : ",\n");
+				first = false;
+
+				auto time = std::uint64_t((event.m_ticks - m_start_ticks) * ns_per_tick);
+				out << "{\"pid\":0,\"tid\":" << thread
+					<< ",\"ts\":" << time / 1000 << "." << (time % 1000) / 100 << (time % 100) / 10 << time % 10;
+
+				switch (event.m_type)
+				{
+				case detail::trace_event_type::frame_begin:
+					out << ",\"ph\":\"B\",\"name\":\"frame " << event.m_frame << "\"}";
+					break;
+				case detail::trace_event_type::frame_end:
+					out << ",\"ph\":\"E\",\"name\":\"frame " << event.m_frame << "\"}";
+					break;
+				case detail::trace_event_type::resume:
+				case detail::trace_event_type::suspend:
+					out << ",\"ph\":\"" << (event.m_type == detail::trace_event_type::resume ? "B" : "E")
+						<< "\",\"name\":\"coroutine " << event.m_coroutine
+						<< "\",\"args\":{\"id\":" << event.m_coroutine << ",\"parent\":" << event.m_parent
+						<< ",\"frame\":" << event.m_frame << "}}";
+					break;
+				}
+			}
+			return count != 0;
+		}
+
+	private:
+		double nanoseconds_per_tick() const
+		{
+			auto ticks = detail::trace_ticks() - m_start_ticks;
+			std::chrono::duration<double, std::nano> elapsed = clock::now() - m_start;
+			return ticks ? elapsed.count() / double(ticks) : 1.0;
+		}
+
+		void record(detail::trace_event_type type, std::uint32_t coroutine, std::uint32_t parent, std::uint64_t ticks)
+		{
+			auto& event = m_events[m_written++ & m_mask];
+			event.m_ticks = ticks;
+			event.m_frame = m_frame;
+			event.m_coroutine = coroutine;
+			event.m_parent = parent;
+			event.m_type = type;
+		}
+
+		clock::time_point m_start;
+		std::uint64_t m_start_ticks;
+		std::unique_ptr<detail::trace_event[]> m_events;
+		std::size_t m_mask;
+		std::uint64_t m_written;
+		std::uint64_t m_frame;
+		std::uint64_t m_suspend_ticks;
+		std::uint32_t m_next_id;
+		std::uint32_t m_awaiting_parent;
+		bool m_suspended;
+		bool m_enabled;
+	};
+
+	// Merges traces of several schedulers, for example of a scheduler group, into one Chrome trace.
+	// Every scheduler becomes its own thread in the viewer.
+	inline void write_chrome_trace(std::ostream& out, const std::vector<const reactor_trace*>& traces)
+	{
+		out << "{\"traceEvents\":[\n";
+		bool first = true;
+		for (std::size_t i = 0; i < traces.size(); i++)
+		{
+			if (traces[i]->write_chrome_events(out, int(i), first))
+			{
+				first = false;
+			}
+		}
+		out << "\n]}\n";
+	}
+}
+
+#endif
@@ -0,0 +1,123 @@
+#ifndef REACTOR_WAKE_LATENCY_HPP_INCLUDED
+#define REACTOR_WAKE_LATENCY_HPP_INCLUDED
+
+#include "reactor_histogram.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+namespace cppcoro
+{
+	// Instrumentation policy measuring how long handles wait between being queued (next_frame,
+	// I/O completion, mailbox post...) and being resumed. Latencies are kept in nanoseconds in a
+	// histogram per source awaitable kind. Awaited children continue right in their awaiter's
+	// resume, so child completion never waits for a frame and is not measured.
+	class reactor_wake_latency : public reactor_instrumentation
+	{
+	public:
+		typedef std::chrono::steady_clock clock;
+
+		struct source_latency
+		{
+			const char* m_source;
+			reactor_histogram m_latency;
+		};
+
+		reactor_wake_latency()
+		{
+		}
+
+		reactor_wake_latency(const reactor_wake_latency&) = delete;
+		reactor_wake_latency& operator=(const reactor_wake_latency&) = delete;
+
+		const std::vector<source_latency>& latencies() const
+		{
+			return m_latencies;
+		}
+
+		// Histogram of given source, null when nothing from it was resumed yet
+		const reactor_histogram* latency(const char* source) const
+		{
+			for (auto& latency : m_latencies)
+			{
+				if (latency.m_source == source || std::strcmp(latency.m_source, source) == 0)
+				{
+					return &latency.m_latency;
+				}
+			}
+			return nullptr;
+		}
+
+		void reset()
+		{
+			for (auto& latency : m_latencies)
+			{
+				latency.m_latency.reset();
+			}
+		}
+
+		// Only the stamp is taken here, other threads enqueue under reactor_thread_safe_enqueue while
+		// the scheduler thread records, histograms are looked up in before_resume
+		void on_enqueue(const char* source)
+		{
+			m_back.push_back({ clock::now(), source });
+		}
+
+		void on_frame_queue(std::size_t queued)
+		{
+			std::swap(m_front, m_back);
+			m_back.clear();
+
+			// Handles requeued after an exception have no stamp, frame is skipped to stay aligned
+			if (m_front.size() != queued)
+			{
+				m_front.clear();
+			}
+		}
+
+		void before_resume(std::size_t index)
+		{
+			if (index < m_front.size())
+			{
+				auto& stamp = m_front[index];
+				auto latency = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - stamp.first);
+				m_latencies[index_of(stamp.second)].m_latency.record(std::uint64_t(latency.count()));
+			}
+		}
+
+	private:
+		// Every source pointer is resolved by content once, afterwards only pointers are compared
+		std::size_t index_of(const char* source)
+		{
+			for (auto& known : m_sources)
+			{
+				if (known.first == source)
+				{
+					return known.second;
+				}
+			}
+
+			std::size_t index = 0;
+			while (index < m_latencies.size() && std::strcmp(m_latencies[index].m_source, source) != 0)
+			{
+				index++;
+			}
+			if (index == m_latencies.size())
+			{
+				m_latencies.push_back({ source, reactor_histogram() });
+			}
+			m_sources.push_back({ source, index });
+			return index;
+		}
+
+		std::vector<std::pair<clock::time_point, const char*> > m_front;
+		std::vector<std::pair<clock::time_point, const char*> > m_back;
+		std::vector<source_latency> m_latencies;
+		std::vector<std::pair<const char*, std::size_t> > m_sources;
+	};
+}
+
+#endif
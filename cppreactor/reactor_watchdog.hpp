@@ -0,0 +1,232 @@
+#ifndef REACTOR_WATCHDOG_HPP_INCLUDED
+#define REACTOR_WATCHDOG_HPP_INCLUDED
+
+#include "reactor_coroutine.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+namespace cppcoro
+{
+	// Coroutine that kept a single resume running past the watchdog threshold
+	struct reactor_watchdog_report
+	{
+		const void* m_coroutine;
+		const char* m_function;
+		const char* m_file;
+		unsigned m_line;
+		std::uint64_t m_frame;
+		std::chrono::nanoseconds m_running_for;
+	};
+
+	inline std::ostream& operator<<(std::ostream& out, const reactor_watchdog_report& report)
+	{
+		return out << "coroutine " << report.m_coroutine << " " << report.m_function
+			<< " (" << report.m_file << ":" << report.m_line << ") running for "
+			<< std::chrono::duration_cast<std::chrono::milliseconds>(report.m_running_for).count()
+			<< "ms in frame " << report.m_frame;
+	}
+
+	// Instrumentation policy with a thread watching for coroutines that do not yield, for example a
+	// loop missing its co_await next_frame{}. Scheduler thread only publishes a resume counter and a
+	// copy of the running coroutine's address and location, the watchdog thread samples them and
+	// reports a resume that stays the same for longer than the threshold, once per resume. Reports
+	// go to the callback on the watchdog thread, by default to std::cerr. Abort is only honoured in
+	// builds without NDEBUG.
+	class reactor_watchdog : public reactor_instrumentation
+	{
+	public:
+		struct coroutine_data
+		{
+			const void* m_coroutine = nullptr;
+			const char* m_function = "";
+			const char* m_file = "";
+			unsigned m_line = 0;
+		};
+
+		reactor_watchdog()
+			: m_sequence(0), m_published(0), m_running_coroutine(nullptr), m_running_function(""),
+			m_running_file(""), m_running_line(0), m_frame(0), m_stop(false), m_abort(false)
+		{
+		}
+
+		reactor_watchdog(const reactor_watchdog&) = delete;
+		reactor_watchdog& operator=(const reactor_watchdog&) = delete;
+
+		~reactor_watchdog()
+		{
+			stop();
+		}
+
+		void start(std::chrono::milliseconds threshold, std::function<void(const reactor_watchdog_report&)> callback = nullptr)
+		{
+			stop();
+			m_threshold = threshold;
+			m_callback = callback ? std::move(callback) : [](const reactor_watchdog_report& report)
+			{
+				std::cerr << "reactor_watchdog: " << report << std::endl;
+			};
+			m_stop = false;
+			m_thread = std::thread([this] { watch(); });
+		}
+
+		void stop()
+		{
+			if (m_thread.joinable())
+			{
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					m_stop = true;
+				}
+				m_wake.notify_one();
+				m_thread.join();
+			}
+		}
+
+		// Aborts the process after reporting, debug builds only. Can be changed while the watchdog runs
+		void set_abort(bool abort)
+		{
+			m_abort.store(abort, std::memory_order_relaxed);
+		}
+
+		static void on_create(coroutine_data& data, const detail::source_location& location)
+		{
+			data.m_function = location.function_name();
+			data.m_file = location.file_name();
+			data.m_line = location.line();
+		}
+
+		void begin_frame()
+		{
+			m_frame.store(m_frame.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		}
+
+		void on_schedule(coroutine_data& data, const void* address)
+		{
+			data.m_coroutine = address;
+		}
+
+		// Odd sequence means a resume is running
+		void before_resume(std::size_t)
+		{
+			m_sequence.store(m_sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+		}
+
+		void after_resume(std::size_t)
+		{
+			m_sequence.store(m_sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+		}
+
+		// Frame of the running coroutine may be freed while the watchdog reads, so its fields are
+		// copied under a sequence lock, odd while they are written
+		void on_resume(coroutine_data& data, bool)
+		{
+			auto published = m_published.load(std::memory_order_relaxed);
+			m_published.store(published + 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+
+			m_running_coroutine.store(data.m_coroutine, std::memory_order_relaxed);
+			m_running_function.store(data.m_function, std::memory_order_relaxed);
+			m_running_file.store(data.m_file, std::memory_order_relaxed);
+			m_running_line.store(data.m_line, std::memory_order_relaxed);
+
+			m_published.store(published + 2, std::memory_order_release);
+		}
+
+	private:
+		// False when the scheduler kept publishing, the sample is skipped then
+		bool read_running(reactor_watchdog_report& report) const
+		{
+			for (int attempt = 0; attempt < 4; attempt++)
+			{
+				auto published = m_published.load(std::memory_order_acquire);
+				if (published & 1)
+				{
+					continue;
+				}
+
+				report.m_coroutine = m_running_coroutine.load(std::memory_order_relaxed);
+				report.m_function = m_running_function.load(std::memory_order_relaxed);
+				report.m_file = m_running_file.load(std::memory_order_relaxed);
+				report.m_line = m_running_line.load(std::memory_order_relaxed);
+
+				std::atomic_thread_fence(std::memory_order_acquire);
+				if (m_published.load(std::memory_order_relaxed) == published)
+				{
+					return true;
+				}
+			}
+			return false;
+		}
+
+		void watch()
+		{
+			typedef std::chrono::steady_clock clock;
+
+			auto period = std::max(std::chrono::milliseconds(1), m_threshold / 4);
+			std::uint64_t seen = 0;
+			std::uint64_t reported = 0;
+			auto seen_at = clock::now();
+
+			std::unique_lock<std::mutex> lock(m_mutex);
+			while (!m_wake.wait_for(lock, period, [this] { return m_stop; }))
+			{
+				auto sequence = m_sequence.load(std::memory_order_acquire);
+				auto now = clock::now();
+				if (sequence != seen)
+				{
+					seen = sequence;
+					seen_at = now;
+					continue;
+				}
+
+				if ((sequence & 1) == 0 || sequence == reported || now - seen_at < m_threshold)
+				{
+					continue;
+				}
+
+				reactor_watchdog_report report{ nullptr, "", "", 0, m_frame.load(std::memory_order_relaxed), now - seen_at };
+				if (!read_running(report) || m_sequence.load(std::memory_order_acquire) != sequence)
+				{
+					continue;
+				}
+
+				reported = sequence;
+				m_callback(report);
+
+#ifndef NDEBUG
+				if (m_abort.load(std::memory_order_relaxed))
+				{
+					std::abort();
+				}
+#endif
+			}
+		}
+
+		std::atomic<std::uint64_t> m_sequence;
+		std::atomic<std::uint64_t> m_published;
+		std::atomic<const void*> m_running_coroutine;
+		std::atomic<const char*> m_running_function;
+		std::atomic<const char*> m_running_file;
+		std::atomic<unsigned> m_running_line;
+		std::atomic<std::uint64_t> m_frame;
+
+		std::chrono::milliseconds m_threshold;
+		std::function<void(const reactor_watchdog_report&)> m_callback;
+		std::thread m_thread;
+		std::mutex m_mutex;
+		std::condition_variable m_wake;
+		bool m_stop;
+		std::atomic<bool> m_abort;
+	};
+}
+
+#endif
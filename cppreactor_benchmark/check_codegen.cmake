@@ -0,0 +1,105 @@
+# Checks assembly of reactor_codegen_probe.cpp, run by ctest:
+#   cmake -DASSEMBLY=<file> -P check_codegen.cmake
+# Counts instructions of each probe function, directives, labels and control flow markers are skipped.
+
+function(probe_instructions name result)
+	file(STRINGS "${ASSEMBLY}" lines)
+	set(inside FALSE)
+	set(instructions "")
+	foreach(line IN LISTS lines)
+		if(line MATCHES "^_?${name}:")
+			set(inside TRUE)
+		elseif(inside)
+			if(line MATCHES "^[ \t]*\\.cfi_endproc" OR line MATCHES "^[ \t]*\\.size[ \t]" OR line MATCHES "^[A-Za-z_][A-Za-z0-9_.$]*:")
+				break()
+			endif()
+			string(STRIP "${line}" line)
+			if(NOT line STREQUAL "" AND NOT line MATCHES "^[.#;/@]" AND NOT line MATCHES ":$" AND NOT line MATCHES "^endbr(32|64)")
+				list(APPEND instructions "${line}")
+			endif()
+		endif()
+	endforeach()
+	if(NOT inside)
+		message(FATAL_ERROR "${name} not found in ${ASSEMBLY}")
+	endif()
+	set(${result} "${instructions}" PARENT_SCOPE)
+endfunction()
+
+function(expect_bare_return name)
+	probe_instructions(${name} instructions)
+	list(LENGTH instructions count)
+	list(GET instructions 0 first)
+	if(NOT count EQUAL 1 OR NOT first MATCHES "^(rep[ \t]+)?ret")
+		message(FATAL_ERROR "${name} is not a bare return:\n${instructions}")
+	endif()
+	message(STATUS "${name}: ${first}")
+endfunction()
+
+expect_bare_return(cppreactor_probe_no_exceptions_rethrow)
+
+probe_instructions(cppreactor_probe_value_next_frame_resume instructions)
+list(LENGTH instructions count)
+if(count LESS 2)
+	message(FATAL_ERROR "cppreactor_probe_value_next_frame_resume should load frame data:\n${instructions}")
+endif()
+message(STATUS "cppreactor_probe_value_next_frame_resume: ${count} instructions")
+
+# Instructions up to the first return, the path taken when nothing unusual happens
+function(fast_path instructions result)
+	set(path "")
+	foreach(instruction IN LISTS instructions)
+		list(APPEND path "${instruction}")
+		if(instruction MATCHES "^(rep[ \t]+)?ret")
+			break()
+		endif()
+	endforeach()
+	set(${result} "${path}" PARENT_SCOPE)
+endfunction()
+
+function(count_matching instructions pattern result)
+	set(count 0)
+	foreach(instruction IN LISTS instructions)
+		if(instruction MATCHES "${pattern}")
+			math(EXPR count "${count} + 1")
+		endif()
+	endforeach()
+	set(${result} ${count} PARENT_SCOPE)
+endfunction()
+
+function(expect_count name instructions pattern expected what)
+	count_matching("${instructions}" "${pattern}" count)
+	if(NOT count EQUAL expected)
+		message(FATAL_ERROR "${name} should have ${expected} ${what}, found ${count}:\n${instructions}")
+	endif()
+endfunction()
+
+set(direct_call "^(call[lq]?[ \t]+[^*]|bl[ \t])")
+set(indirect_call "^(call[lq]?[ \t]+\\*|blr[ \t])")
+# AT&T x86 moves from and to memory, other targets only get the portable checks
+set(memory_load "^mov[a-z]*[ \t]+[-0-9]*\\(")
+set(memory_store "^mov[a-z]*[ \t]+%[a-z0-9]+,[ \t]*[-0-9]*\\(")
+
+# Queueing the handle with empty frame data: node store and a vector push inline, no frame data load
+probe_instructions(cppreactor_probe_default_next_frame_suspend instructions)
+fast_path("${instructions}" path)
+expect_count(cppreactor_probe_default_next_frame_suspend "${path}" "${direct_call}" 0 "calls before returning")
+if(path MATCHES "%r")
+	# Scheduler, back queue, its end and capacity
+	expect_count(cppreactor_probe_default_next_frame_suspend "${path}" "${memory_load}" 4 "loads before returning")
+	# Node handle, queued handle and new end
+	expect_count(cppreactor_probe_default_next_frame_suspend "${path}" "${memory_store}" 3 "stores before returning")
+endif()
+list(LENGTH path count)
+message(STATUS "cppreactor_probe_default_next_frame_suspend: ${count} instructions before returning")
+
+# Default update: frame hook walks, one prefetch branch and the resume, nothing called out of line
+probe_instructions(cppreactor_probe_default_update instructions)
+expect_count(cppreactor_probe_default_update "${instructions}" "${direct_call}" 0 "direct calls")
+expect_count(cppreactor_probe_default_update "${instructions}" "${indirect_call}" 3 "indirect calls, begin and end hooks and the resume")
+expect_count(cppreactor_probe_default_update "${instructions}" "^(prefetch|prfm)" 2 "prefetches")
+if(instructions MATCHES "%r")
+	# Queue swap and clear, empty frame data is not stored
+	expect_count(cppreactor_probe_default_update "${instructions}" "${memory_store}" 2 "stores")
+endif()
+list(LENGTH instructions count)
+message(STATUS "cppreactor_probe_default_update: ${count} instructions")
@@ -0,0 +1,857 @@
+#include "../cppreactor/reactor_coroutine.hpp"
+#include "../cppreactor/reactor_realtime.hpp"
+#include "../cppreactor/reactor_stats.hpp"
+#include "../cppreactor/reactor_trace.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <unistd.h>
+#endif
+
+using namespace cppcoro;
+
+// Every heap allocation of the process is counted, coroutine frames included. Array and aligned
+// forms are replaced as well, the library versions of the aligned ones bypass operator new.
+namespace
+{
+	std::atomic<std::size_t> g_allocations{ 0 };
+
+	void* counted_allocate(std::size_t size)
+	{
+		g_allocations.fetch_add(1, std::memory_order_relaxed);
+		if (void* memory = std::malloc(size ? size : 1))
+		{
+			return memory;
+		}
+		throw std::bad_alloc();
+	}
+
+	void* counted_allocate(std::size_t size, std::align_val_t alignment)
+	{
+		g_allocations.fetch_add(1, std::memory_order_relaxed);
+		auto align = static_cast<std::size_t>(alignment);
+#if defined(_MSC_VER)
+		void* memory = _aligned_malloc(size ? size : 1, align);
+#else
+		// Aligned allocation takes a size that is a multiple of the alignment
+		void* memory = std::aligned_alloc(align, (std::max<std::size_t>(size, 1) + align - 1) / align * align);
+#endif
+		if (memory)
+		{
+			return memory;
+		}
+		throw std::bad_alloc();
+	}
+
+	void release_aligned(void* memory) noexcept
+	{
+#if defined(_MSC_VER)
+		_aligned_free(memory);
+#else
+		std::free(memory);
+#endif
+	}
+}
+
+void* operator new(std::size_t size)
+{
+	return counted_allocate(size);
+}
+
+void* operator new[](std::size_t size)
+{
+	return counted_allocate(size);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+	return counted_allocate(size, alignment);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+	return counted_allocate(size, alignment);
+}
+
+// GCC pairs the inlined free with the replaced operator new at the call site and reports a mismatch
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void operator delete(void* memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept
+{
+	release_aligned(memory);
+}
+
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept
+{
+	release_aligned(memory);
+}
+
+void operator delete[](void* memory, std::align_val_t) noexcept
+{
+	release_aligned(memory);
+}
+
+void operator delete[](void* memory, std::size_t, std::align_val_t) noexcept
+{
+	release_aligned(memory);
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+namespace
+{
+	std::size_t resident_set_bytes()
+	{
+#if defined(__linux__)
+		std::ifstream statm("/proc/self/statm");
+		std::size_t pages = 0, resident = 0;
+		statm >> pages >> resident;
+		return resident * static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+#else
+		return 0;
+#endif
+	}
+
+	struct benchmark_result
+	{
+		std::string m_name;
+		std::vector<std::pair<std::string, long long> > m_parameters;
+		long long m_frames;
+		double m_ns_per_resume;
+		double m_allocations_per_frame;
+		std::size_t m_rss_bytes;
+	};
+
+	struct benchmark_options
+	{
+		bool m_quick = false;
+		std::size_t m_max_coroutines = 1'000'000;
+		std::string m_out;
+	};
+
+	// Runs frame function for given number of frames and reports cost of a single resume
+	template <class F>
+	benchmark_result measure(std::string name, std::vector<std::pair<std::string, long long> > parameters,
+		long long frames, long long resumes_per_frame, F&& frame)
+	{
+		auto allocations = g_allocations.load(std::memory_order_relaxed);
+		auto start = std::chrono::high_resolution_clock::now();
+
+		for (long long i = 0; i < frames; i++)
+		{
+			frame();
+		}
+
+		auto end = std::chrono::high_resolution_clock::now();
+		allocations = g_allocations.load(std::memory_order_relaxed) - allocations;
+
+		std::chrono::duration<double, std::nano> duration = end - start;
+
+		benchmark_result result;
+		result.m_name = std::move(name);
+		result.m_parameters = std::move(parameters);
+		result.m_frames = frames;
+		result.m_ns_per_resume = duration.count() / (double(frames) * double(resumes_per_frame));
+		result.m_allocations_per_frame = double(allocations) / double(frames);
+		result.m_rss_bytes = resident_set_bytes();
+
+		std::cerr << result.m_name;
+		for (auto& parameter : result.m_parameters)
+		{
+			std::cerr << " " << parameter.first << "=" << parameter.second;
+		}
+		std::cerr << ": " << result.m_ns_per_resume << " ns/resume, " << result.m_allocations_per_frame << " allocations/frame" << std::endl;
+
+		return result;
+	}
+
+	// Keeps total amount of resumes per case roughly constant
+	long long frames_for(const benchmark_options& options, long long resumes_per_frame)
+	{
+		long long budget = options.m_quick ? 200'000 : 50'000'000;
+		long long frames = budget / resumes_per_frame;
+		return frames < 3 ? 3 : frames;
+	}
+
+	template <class... Policies>
+	reactor_coroutine<reactor_default_frame_data, Policies...> infinite_frames()
+	{
+		for (;;)
+			co_await next_frame{};
+	}
+
+	template <class... Policies>
+	void resume_case(const benchmark_options& options, const char* name, std::vector<benchmark_result>& results)
+	{
+		for (std::size_t count = 1; count <= options.m_max_coroutines; count *= options.m_quick ? 100 : 10)
+		{
+			std::vector<reactor_coroutine<reactor_default_frame_data, Policies...> > coroutines;
+			coroutines.reserve(count);
+
+			reactor_scheduler<reactor_default_frame_data, Policies...> s;
+			for (std::size_t i = 0; i < count; i++)
+			{
+				coroutines.push_back(infinite_frames<Policies...>());
+				s.push(coroutines.back());
+			}
+			s.update_next_frame();
+
+			results.push_back(measure(name, { { "coroutines", count } }, frames_for(options, count), count,
+				[&] { s.update_next_frame(); }));
+		}
+	}
+
+	// Handle array against awaiter nodes linked in place
+	void resume_benchmark(const benchmark_options& options, std::vector<benchmark_result>& results)
+	{
+		resume_case<>(options, "resume", results);
+		resume_case<reactor_intrusive_queue>(options, "resume_intrusive", results);
+	}
+
+	// Resume order shuffled against allocation order, as with coroutines spawned over a long run,
+	// with and without prefetching frames ahead of the resume loop
+	void prefetch_case(const benchmark_options& options, std::size_t distance, std::vector<benchmark_result>& results)
+	{
+		std::mt19937 random(42);
+		for (std::size_t count = 1000; count <= options.m_max_coroutines; count *= options.m_quick ? 100 : 10)
+		{
+			std::vector<reactor_coroutine<> > coroutines;
+			coroutines.reserve(count);
+			for (std::size_t i = 0; i < count; i++)
+			{
+				coroutines.push_back(infinite_frames<>());
+			}
+			std::shuffle(coroutines.begin(), coroutines.end(), random);
+
+			reactor_scheduler<> s;
+			s.set_prefetch_distance(distance);
+			for (auto& c : coroutines)
+			{
+				s.push(c);
+			}
+			s.update_next_frame();
+
+			results.push_back(measure("resume_shuffled", { { "coroutines", count }, { "prefetch", distance } }, frames_for(options, count), count,
+				[&] { s.update_next_frame(); }));
+		}
+	}
+
+	// Frames taken in order from one pool block, resumed in the same order
+	void pooled_case(const benchmark_options& options, std::size_t distance, std::vector<benchmark_result>& results)
+	{
+		typedef reactor_coroutine<reactor_default_frame_data, reactor_realtime> pooled_coroutine;
+
+		for (std::size_t count = 1000; count <= options.m_max_coroutines; count *= options.m_quick ? 100 : 10)
+		{
+			reactor_realtime::reserve_frames(128, count);
+			{
+				std::vector<pooled_coroutine> coroutines;
+				coroutines.reserve(count);
+
+				reactor_scheduler<reactor_default_frame_data, reactor_realtime> s;
+				s.reserve(count);
+				s.set_prefetch_distance(distance);
+				for (std::size_t i = 0; i < count; i++)
+				{
+					coroutines.push_back(infinite_frames<reactor_realtime>());
+					s.push(coroutines.back());
+				}
+				s.update_next_frame();
+
+				results.push_back(measure("resume_pooled", { { "coroutines", count }, { "prefetch", distance } }, frames_for(options, count), count,
+					[&] { s.update_next_frame(); }));
+			}
+			reactor_realtime::release_frames();
+		}
+	}
+
+	void prefetch_benchmark(const benchmark_options& options, std::vector<benchmark_result>& results)
+	{
+		for (std::size_t distance : { 0, 4, 8, 16 })
+		{
+			prefetch_case(options, distance, results);
+		}
+		for (std::size_t distance : { 0, 8 })
+		{
+			pooled_case(options, distance, results);
+		}
+	}
+
+	// Straight line code different for every kind, like bodies of actor types
+	template <int Kind, int... Steps>
+	std::size_t kind_work(std::size_t state, std::integer_sequence<int, Steps...>)
+	{
+		((state = state * (2 * (Kind + Steps) + 1) + (state >> ((Kind + Steps) % 13 + 1))), ...);
+		return state;
+	}
+
+	template <int Kind, class... Policies>
+	reactor_coroutine<reactor_default_frame_data, Policies...> kind_frames(std::size_t& checksum)
+	{
+		std::size_t state = Kind;
+		for (;;)
+		{
+			co_await next_frame{};
+			state = kind_work<Kind>(state, std::make_integer_sequence<int, 16>());
+			checksum += state;
+		}
+	}
+
+	template <class... Policies>
+	struct kind_table
+	{
+		typedef reactor_coroutine<reactor_default_frame_data, Policies...> (*factory)(std::size_t&);
+
+		template <int... Kinds>
+		static std::vector<factory> make(std::integer_sequence<int, Kinds...>)
+		{
+			return { &kind_frames<Kinds, Policies...>... };
+		}
+	};
+
+	// 200 coroutine kinds queued round robin, resumed in queue order or grouped by kind. Frames are
+	// allocated round robin too, or kind by kind as when every kind is spawned at once.
+	template <class... Policies>
+	void kinds_case(const benchmark_options& options, const char* name, bool allocated_by_kind, std::vector<benchmark_result>& results)
+	{
+		auto kinds = kind_table<Policies...>::make(std::make_integer_sequence<int, 200>());
+		std::size_t checksum = 0;
+
+		for (std::size_t count = 1000; count <= std::min<std::size_t>(options.m_max_coroutines, 1'000'000); count *= options.m_quick ? 100 : 10)
+		{
+			const std::size_t per_kind = count / kinds.size();
+
+			std::vector<reactor_coroutine<reactor_default_frame_data, Policies...> > coroutines;
+			coroutines.reserve(count);
+			for (std::size_t i = 0; i < count; i++)
+			{
+				coroutines.push_back(kinds[allocated_by_kind ? i / per_kind : i % kinds.size()](checksum));
+			}
+
+			reactor_scheduler<reactor_default_frame_data, Policies...> s;
+			for (std::size_t i = 0; i < count; i++)
+			{
+				s.push(coroutines[allocated_by_kind ? (i % kinds.size()) * per_kind + i / kinds.size() : i]);
+			}
+			s.update_next_frame();
+
+			results.push_back(measure(name, { { "coroutines", count }, { "kinds", kinds.size() }, { "allocated_by_kind", allocated_by_kind } },
+				frames_for(options, count), count, [&] { s.update_next_frame(); }));
+		}
+	}
+
+	void kinds_benchmark(const benchmark_options& options, std::vector<benchmark_result>& results)
+	{
+		for (bool allocated_by_kind : { false, true })
+		{
+			kinds_case<>(options, "resume_kinds", allocated_by_kind, results);
+			kinds_case<reactor_grouped_queue>(options, "resume_kinds_grouped", allocated_by_kind, results);
+		}
+	}
+
+	template <class Policy>
+	reactor_coroutine<reactor_default_frame_data, Policy> infinite_frames_with()
+	{
+		for (;;)
+			co_await next_frame{};
+	}
+
+	// Same as resume but every resume goes through an instrumentation policy
+	template <class Policy>
+	void instrumented_case(const benchmark_options& options, const char* name, std::vector<benchmark_result>& results)
+	{
+		const std::size_t count = options.m_quick ? 1000 : 100'000;
+
+		std::vector<reactor_coroutine<reactor_default_frame_data, Policy> > coroutines;
+		reactor_scheduler<reactor_default_frame_data, Policy> s;
+		for (std::size_t i = 0; i < count; i++)
+		{
+			coroutines.push_back(infinite_frames_with<Policy>());
+		}
+		for (auto& c : coroutines)
+		{
+			s.push(c);
+		}
+		s.update_next_frame();
+
+		results.push_back(measure(name, { { "coroutines", count } }, frames_for(options, count), count,
+			[&] { s.update_next_frame(); }));
+	}
+
+	void instrumented_benchmark(const benchmark_options& options, std::vector<benchmark_result>& results)
+	{
+		instrumented_case<reactor_stats>(options, "resume_with_stats", results);
+		instrumented_case<reactor_trace>(options, "resume_with_trace", results);
+	}
+
+	reactor_coroutine<> nested_leaf_await(int depth)
+	{
+		if (depth == 0)
+		{
+			co_await next_frame{};
+			co_return;
+		}
+		co_await nested_leaf_await(depth - 1);
+	}
+
+	reactor_coroutine<> nested_root(int depth)
+	{
+		for (;;)
+			co_await nested_leaf_await(depth);
+	}
+
+	// Every frame the leaf completes, the whole chain unwinds and is awaited again from the root
+	void nested_benchmark(const benchmark_options& options, std::vector<benchmark_result>& results)
+	{
+		const std::size_t roots = options.m_quick ? 100 : 1000;
+		for (int depth : { 1, 4, 16, 64 })
+		{
+			std::vector<reactor_coroutine<> > coroutines;
+			reactor_scheduler<> s;
+			for (std::size_t i = 0; i < roots; i++)
+			{
+				coroutines.push_back(nested_root(depth));
+			}
+			for (auto& c : coroutines)
+			{
+				s.push(c);
+			}
+			s.update_next_frame();
+
+			long long frames = frames_for(options, roots * depth);
+			results.push_back(measure("nested_await", { { "depth", depth }, { "roots", roots } }, frames, roots,
+				[&] { s.update_next_frame(); }));
+		}
+	}
+
+	template <std::size_t Size>
+	reactor_coroutine_return<std::array<char, Size> > value_after_frame()
+	{
+		co_await next_frame{};
+		co_return std::array<char, Size>{};
+	}
+
+	template <std::size_t Size>
+	reactor_coroutine<> value_root(std::size_t& checksum)
+	{
+		for (;;)
+		{
+			auto value = co_await value_after_frame<Size>();
+			checksum += value[Size - 1];
+		}
+	}
+
+	template <std::size_t Size>
+	void return_value_case(const benchmark_options& options, std::vector<benchmark_result>& results)
+	{
+		const std::size_t roots = options.m_quick ? 100 : 1000;
+		std::size_t checksum = 0;
+
+		std::vector<reactor_coroutine<> > coroutines;
+		reactor_scheduler<> s;
+		for (std::size_t i = 0; i < roots; i++)
+		{
+			coroutines.push_back(value_root<Size>(checksum));
+		}
+		for (auto& c : coroutines)
+		{
+			s.push(c);
+		}
+		s.update_next_frame();
+
+		long long frames = frames_for(options, roots * (1 + Size / 64));
+		results.push_back(measure("return_value", { { "bytes", Size }, { "roots", roots } }, frames, roots,
+			[&] { s.update_next_frame(); }));
+	}
+
+	typedef std::array<char, 4096> page_payload;
+
+	// Move-only 4KB payload, the buffer changes owner without copying its bytes
+	typedef std::unique_ptr<page_payload> owned_payload;
+
+	reactor_coroutine_return<page_payload> page_chain(int depth)
+	{
+		if (depth == 0)
+		{
+			co_await next_frame{};
+			page_payload page;
+			page[page.size() - 1] = 1;
+			co_return page;
+		}
+		auto page = co_await page_chain(depth - 1);
+		co_return page;
+	}
+
+	reactor_coroutine_return<owned_payload> owned_chain(owned_payload& spare, int depth)
+	{
+		if (depth == 0)
+		{
+			co_await next_frame{};
+			co_return std::move(spare);
+		}
+		auto payload = co_await owned_chain(spare, depth - 1);
+		co_return payload;
+	}
+
+	reactor_coroutine<> page_root(std::size_t& checksum, int depth)
+	{
+		for (;;)
+		{
+			auto page = co_await page_chain(depth);
+			checksum += page[page.size() - 1];
+		}
+	}
+
+	reactor_coroutine<> owned_root(std::size_t& checksum, int depth)
+	{
+		auto spare = std::make_unique<page_payload>();
+		(*spare)[spare->size() - 1] = 1;
+		for (;;)
+		{
+			spare = co_await owned_chain(spare, depth);
+			checksum += (*spare)[spare->size() - 1];
+		}
+	}
+
+	// 4KB returned through a chain of awaits every frame, by value and as a move-only owner
+	template <class Root>
+	void return_chain_case(const benchmark_options& options, const char* name, int depth, Root root, std::vector<benchmark_result>& results)
+	{
+		const std::size_t roots = options.m_quick ? 100 : 1000;
+		std::size_t checksum = 0;
+
+		std::vector<reactor_coroutine<> > coroutines;
+		reactor_scheduler<> s;
+		for (std::size_t i = 0; i < roots; i++)
+		{
+			coroutines.push_back(root(checksum, depth));
+		}
+		for (auto& c : coroutines)
+		{
+			s.push(c);
+		}
+		s.update_next_frame();
+
+		long long frames = frames_for(options, roots * depth * 16);
+		results.push_back(measure(name, { { "bytes", sizeof(page_payload) }, { "depth", depth }, { "roots", roots } }, frames, roots,
+			[&] { s.update_next_frame(); }));
+	}
+
+	void return_value_benchmark(const benchmark_options& options, std::vector<benchmark_result>& results)
+	{
+		return_value_case<8>(options, results);
+		return_value_case<64>(options, results);
+		return_value_case<512>(options, results);
+		return_value_case<4096>(options, results);
+
+		for (int depth : { 1, 4, 16 })
+		{
+			return_chain_case(options, "return_chain_value", depth, page_root, results);
+			return_chain_case(options, "return_chain_move_only", depth, owned_root, results);
+		}
+	}
+
+	// Values streamed from a producer to a consumer within frames, by generator and by a coroutine call per value
+	reactor_generator<std::size_t> produce_values(std::size_t per_frame)
+	{
+		for (std::size_t i = 0;; i++)
+		{
+			co_yield i;
+			if ((i + 1) % per_frame == 0)
+			{
+				co_await next_frame{};
+			}
+		}
+	}
+
+	reactor_coroutine<> consume_generated(std::size_t per_frame, std::size_t& checksum)
+	{
+		auto values = produce_values(per_frame);
+		while (auto value = co_await values.next())
+		{
+			checksum += *value;
+		}
+	}
+
+	reactor_coroutine_return<std::size_t> produce_value(std::size_t i)
+	{
+		co_return i;
+	}
+
+	reactor_coroutine<> consume_called(std::size_t per_frame, std::size_t& checksum)
+	{
+		for (std::size_t i = 0;; i++)
+		{
+			checksum += co_await produce_value(i);
+			if ((i + 1) % per_frame == 0)
+			{
+				co_await next_frame{};
+			}
+		}
+	}
+
+	void pipeline_benchmark(const benchmark_options& options, std::vector<benchmark_result>& results)
+	{
+		const std::size_t per_frame = options.m_quick ? 1000 : 100'000;
+		std::size_t checksum = 0;
+		long long frames = frames_for(options, per_frame);
+
+		{
+			reactor_scheduler<> s;
+			auto consumer = consume_generated(per_frame, checksum);
+			s.push(consumer);
+			s.update_next_frame();
+			results.push_back(measure("pipeline_generator", { { "values", per_frame } }, frames, per_frame,
+				[&] { s.update_next_frame(); }));
+		}
+		{
+			reactor_scheduler<> s;
+			auto consumer = consume_called(per_frame, checksum);
+			s.push(consumer);
+			s.update_next_frame();
+			results.push_back(measure("pipeline_call_per_value", { { "values", per_frame } }, frames, per_frame,
+				[&] { s.update_next_frame(); }));
+		}
+	}
+
+	reactor_coroutine<> complete_immediately(std::size_t& completed)
+	{
+		completed++;
+		co_return;
+	}
+
+	reactor_coroutine<> complete_next_frame(std::size_t& completed)
+	{
+		co_await next_frame{};
+		completed++;
+	}
+
+	// Full lifecycle of short lived coroutines: call, push, first resume, completion and frame
+	// release when the finished coroutine object is replaced. Every frame completes the previous
+	// generation before the next one is spawned.
+	template <class F>
+	void spawn_case(const benchmark_options& options, const char* name, F spawn, std::vector<benchmark_result>& results)
+	{
+		const std::size_t per_frame = options.m_quick ? 100 : 10'000;
+		std::size_t completed = 0;
+
+		reactor_scheduler<> s;
+		std::vector<reactor_coroutine<> > coroutines(per_frame);
+
+		results.push_back(measure(name, { { "per_frame", per_frame } }, frames_for(options, per_frame * 4), per_frame,
+			[&]
+			{
+				const std::size_t target = completed + per_frame;
+				for (auto& c : coroutines)
+				{
+					c = spawn(completed);
+					s.push(c);
+				}
+				while (completed != target)
+				{
+					s.update_next_frame();
+				}
+			}));
+	}
+
+	reactor_coroutine<reactor_default_frame_data, reactor_realtime> complete_next_frame_realtime(std::size_t& completed)
+	{
+		co_await next_frame{};
+		completed++;
+	}
+
+	// Same as spawn_complete_next_frame with preallocated queues and frames from the pool
+	void spawn_realtime_case(const benchmark_options& options, std::vector<benchmark_result>& results)
+	{
+		const std::size_t per_frame = options.m_quick ? 100 : 10'000;
+		std::size_t completed = 0;
+
+		reactor_realtime::reserve_frames(256, per_frame);
+		{
+			reactor_scheduler<reactor_default_frame_data, reactor_realtime> s;
+			s.reserve(per_frame);
+			std::vector<reactor_coroutine<reactor_default_frame_data, reactor_realtime> > coroutines(per_frame);
+
+			results.push_back(measure("spawn_complete_next_frame_realtime", { { "per_frame", per_frame } }, frames_for(options, per_frame * 4), per_frame,
+				[&]
+				{
+					const std::size_t target = completed + per_frame;
+					for (auto& c : coroutines)
+					{
+						// Pool holds a single generation, previous frame goes back before the next is taken
+						c = reactor_coroutine<reactor_default_frame_data, reactor_realtime>();
+						c = complete_next_frame_realtime(completed);
+						s.push(c);
+					}
+					while (completed != target)
+					{
+						s.update_next_frame();
+					}
+				}));
+		}
+		reactor_realtime::release_frames();
+	}
+
+	void spawn_benchmark(const benchmark_options& options, std::vector<benchmark_result>& results)
+	{
+		spawn_case(options, "spawn_complete", complete_immediately, results);
+		spawn_case(options, "spawn_complete_next_frame", complete_next_frame, results);
+		spawn_realtime_case(options, results);
+	}
+
+	struct big_frame_data
+	{
+		float m_delta;
+		int m_data[100];
+	};
+
+	template <class T>
+	reactor_coroutine<T> read_frame_data(std::size_t& checksum)
+	{
+		for (;;)
+		{
+			decltype(auto) data = co_await next_frame<T>{};
+			checksum += data.m_data[99];
+		}
+	}
+
+	template <class T>
+	void frame_data_case(const benchmark_options& options, const char* name, std::vector<benchmark_result>& results)
+	{
+		const std::size_t count = options.m_quick ? 1000 : 100'000;
+		std::size_t checksum = 0;
+		big_frame_data data{};
+
+		std::vector<reactor_coroutine<T> > coroutines;
+		reactor_scheduler<T> s;
+		for (std::size_t i = 0; i < count; i++)
+		{
+			coroutines.push_back(read_frame_data<T>(checksum));
+		}
+		for (auto& c : coroutines)
+		{
+			s.push(c);
+		}
+		s.update_next_frame(data);
+
+		results.push_back(measure(name, { { "coroutines", count }, { "bytes", sizeof(big_frame_data) } }, frames_for(options, count), count,
+			[&] { s.update_next_frame(data); }));
+	}
+
+	void frame_data_benchmark(const benchmark_options& options, std::vector<benchmark_result>& results)
+	{
+		frame_data_case<big_frame_data>(options, "frame_data_by_value", results);
+		frame_data_case<const big_frame_data&>(options, "frame_data_by_reference", results);
+	}
+
+	std::string to_json(const std::vector<benchmark_result>& results)
+	{
+		std::ostringstream out;
+		out << "{\n  \"benchmarks\": [\n";
+		for (std::size_t i = 0; i < results.size(); i++)
+		{
+			auto& result = results[i];
+			out << "    { \"name\": \"" << result.m_name << "\", \"parameters\": { ";
+			for (std::size_t p = 0; p < result.m_parameters.size(); p++)
+			{
+				out << (p ? ", " : "") << "\"" << result.m_parameters[p].first << "\": " << result.m_parameters[p].second;
+			}
+			out << " }, \"frames\": " << result.m_frames
+				<< ", \"ns_per_resume\": " << result.m_ns_per_resume
+				<< ", \"allocations_per_frame\": " << result.m_allocations_per_frame
+				<< ", \"rss_bytes\": " << result.m_rss_bytes << " }"
+				<< (i + 1 < results.size() ? ",\n" : "\n");
+		}
+		out << "  ]\n}\n";
+		return out.str();
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	benchmark_options options;
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "--quick") == 0)
+		{
+			options.m_quick = true;
+			options.m_max_coroutines = 10'000;
+		}
+		else if (std::strcmp(argv[i], "--max-coroutines") == 0 && i + 1 < argc)
+		{
+			options.m_max_coroutines = std::strtoull(argv[++i], nullptr, 10);
+		}
+		else if (std::strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+		{
+			options.m_out = argv[++i];
+		}
+		else
+		{
+			std::cerr << "Usage: " << argv[0] << " [--quick] [--max-coroutines N] [--out results.json]" << std::endl;
+			return 1;
+		}
+	}
+
+	std::vector<benchmark_result> results;
+	resume_benchmark(options, results);
+	prefetch_benchmark(options, results);
+	kinds_benchmark(options, results);
+	instrumented_benchmark(options, results);
+	nested_benchmark(options, results);
+	return_value_benchmark(options, results);
+	pipeline_benchmark(options, results);
+	spawn_benchmark(options, results);
+	frame_data_benchmark(options, results);
+
+	auto json = to_json(results);
+	if (options.m_out.empty())
+	{
+		std::cout << json;
+	}
+	else
+	{
+		std::ofstream(options.m_out) << json;
+	}
+	return 0;
+}
@@ -0,0 +1,86 @@
+// Compiled to assembly only and without exceptions, check_codegen.cmake asserts what each probe compiles to.
+// Layout that the hot path relies on is asserted at compile time, the check fails to build without it.
+#include "reactor_coroutine.hpp"
+#include "reactor_expected.hpp"
+
+#include <type_traits>
+
+using namespace cppcoro;
+
+namespace
+{
+	struct value_frame_data
+	{
+		float m_delta;
+		int m_frame;
+	};
+}
+
+// Copies of empty frame data compile to nothing whether it is stored or not, what the scheduler
+// saves is the byte it would reserve. Scheduler keeps frame data as a no_unique_address member,
+// the trailing byte shows it takes no storage even where no tail padding hides it.
+namespace
+{
+	struct frame_data_layout
+	{
+		REACTOR_NO_UNIQUE_ADDRESS detail::reference_to_pointer<reactor_default_frame_data> m_frame_data;
+		char m_byte;
+	};
+}
+
+static_assert(std::is_empty<detail::reference_to_pointer<reactor_default_frame_data> >::value, "empty frame data must not be stored");
+static_assert(sizeof(frame_data_layout) == sizeof(char), "empty frame data must not take space in the scheduler");
+
+// Frame data with a value is loaded through the scheduler, shows the check sees instructions at all
+extern "C" int cppreactor_probe_value_next_frame_resume(next_frame<value_frame_data>& awaitable)
+{
+	return awaitable.await_resume().m_frame;
+}
+
+// Empty frame data is neither stored nor read, next_frame only queues the handle
+extern "C" bool cppreactor_probe_default_next_frame_suspend(next_frame<>& awaitable, detail::coro::coroutine_handle<> handle)
+{
+	return awaitable.await_suspend(handle);
+}
+
+// Default resume loop with its prefetch branch, frame hooks and empty instrumentation. Only the try
+// around it is left out, the probe builds without exceptions.
+extern "C" void cppreactor_probe_default_update(reactor_scheduler<reactor_default_frame_data, reactor_no_exceptions>& scheduler)
+{
+	scheduler.update_next_frame();
+}
+
+typedef detail::reactor_coroutine_promise_return<reactor_expected<int, int>, reactor_default_frame_data, reactor_no_exceptions> quiet_promise;
+
+// Completion of a coroutine without exceptions checks nothing
+extern "C" void cppreactor_probe_no_exceptions_rethrow(quiet_promise& promise)
+{
+	promise.rethrow_if_exception();
+}
+
+reactor_coroutine_return<reactor_expected<int, int>, reactor_default_frame_data, reactor_no_exceptions> quiet_child(int value)
+{
+	co_await next_frame{};
+	if (value < 0)
+	{
+		co_return reactor_unexpected(value);
+	}
+	co_return value;
+}
+
+reactor_coroutine<reactor_default_frame_data, reactor_no_exceptions> quiet_parent(int& sum)
+{
+	for (;;)
+	{
+		auto value = co_await quiet_child(sum);
+		sum += value ? *value : value.error();
+	}
+}
+
+// Whole scheduler and nested expected awaits build with -fno-exceptions
+extern "C" void cppreactor_probe_no_exceptions_update(reactor_scheduler<reactor_default_frame_data, reactor_no_exceptions>& scheduler, int& sum)
+{
+	auto coroutine = quiet_parent(sum);
+	scheduler.push(coroutine);
+	scheduler.update_next_frame();
+}
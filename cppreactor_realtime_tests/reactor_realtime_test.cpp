@@ -0,0 +1,220 @@
+#include "../cppreactor_tests/catch.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <exception>
+#include <new>
+#include <string>
+#include <vector>
+#include "../cppreactor/reactor_realtime.hpp"
+
+using namespace cppcoro;
+
+// Heap allocations of this test executable, checked around scheduler updates only
+namespace
+{
+	std::atomic<std::size_t> g_allocations{ 0 };
+
+	// Frame pool of the test thread lives only as long as the test
+	struct reserved_frames
+	{
+		reserved_frames(std::size_t frame_size, std::size_t capacity)
+		{
+			reactor_realtime::reserve_frames(frame_size, capacity);
+		}
+
+		~reserved_frames()
+		{
+			reactor_realtime::release_frames();
+		}
+	};
+}
+
+void* operator new(std::size_t size)
+{
+	g_allocations.fetch_add(1, std::memory_order_relaxed);
+	if (void* memory = std::malloc(size ? size : 1))
+	{
+		return memory;
+	}
+	throw std::bad_alloc();
+}
+
+// Catch registers tests with nothrow new, it has to pair with the replaced delete
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+	g_allocations.fetch_add(1, std::memory_order_relaxed);
+	return std::malloc(size ? size : 1);
+}
+
+void operator delete(void* memory) noexcept
+{
+	std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+	std::free(memory);
+}
+
+typedef reactor_coroutine<reactor_default_frame_data, reactor_realtime> realtime_coroutine;
+typedef reactor_scheduler<reactor_default_frame_data, reactor_realtime> realtime_scheduler;
+
+realtime_coroutine realtime_child(int& completed)
+{
+	co_await next_frame{};
+	completed++;
+}
+
+realtime_coroutine realtime_parent(int& completed)
+{
+	for (;;)
+	{
+		co_await realtime_child(completed);
+	}
+}
+
+realtime_coroutine realtime_spawned(int& completed)
+{
+	completed++;
+	co_return;
+}
+
+TEST_CASE("Realtime scheduler does not allocate after warm-up", "[reactor_realtime]") {
+
+	reserved_frames frames(512, 64);
+	{
+		realtime_scheduler s;
+		s.reserve(32);
+
+		int completed = 0;
+		std::vector<realtime_coroutine> parents;
+		std::vector<realtime_coroutine> spawned(8);
+		parents.reserve(8);
+		for (int i = 0; i < 8; i++)
+		{
+			parents.push_back(realtime_parent(completed));
+			s.push(parents.back());
+		}
+
+		auto frame = [&]
+		{
+			// Previous generation completed, replacing it releases its frames back to the pool
+			for (auto& c : spawned)
+			{
+				c = realtime_spawned(completed);
+				s.push(c);
+			}
+			s.update_next_frame();
+		};
+
+		for (int i = 0; i < 3; i++)
+		{
+			frame();
+		}
+
+		auto allocations = g_allocations.load(std::memory_order_relaxed);
+		auto before = completed;
+		for (int i = 0; i < 100; i++)
+		{
+			frame();
+		}
+		allocations = g_allocations.load(std::memory_order_relaxed) - allocations;
+
+		REQUIRE(allocations == 0);
+		REQUIRE(completed - before == 100 * 16);
+
+		auto counters = s.policy<reactor_realtime>().counters();
+		REQUIRE(counters.m_frame_overflows == 0);
+		REQUIRE(counters.m_frames_in_use == 24);
+		REQUIRE(counters.m_frame_peak <= 32);
+		REQUIRE(counters.m_frame_allocations > 100 * 16);
+	}
+	REQUIRE(reactor_realtime::frame_pool().in_use() == 0);
+}
+
+realtime_coroutine realtime_frames(int& resumed)
+{
+	for (;;)
+	{
+		co_await next_frame{};
+		resumed++;
+	}
+}
+
+TEST_CASE("Realtime scheduler runs queues filled to capacity", "[reactor_realtime]") {
+
+	reserved_frames frames(512, 8);
+	{
+		realtime_scheduler s;
+		s.reserve(2);
+
+		bool overflow = false;
+		s.policy<reactor_realtime>().set_overflow_callback([&](const char*) { overflow = true; });
+
+		int resumed = 0;
+		realtime_coroutine a = realtime_frames(resumed);
+		realtime_coroutine b = realtime_frames(resumed);
+		s.push(a);
+		s.push(b);
+
+		s.update_next_frame();
+		s.update_next_frame();
+		s.update_next_frame();
+		REQUIRE(resumed == 4);
+		REQUIRE(overflow == false);
+	}
+	REQUIRE(reactor_realtime::frame_pool().in_use() == 0);
+}
+
+namespace
+{
+	std::string g_overflow_source;
+}
+
+// Hidden, ctest runs it on its own because the process does not survive it
+TEST_CASE("Realtime scheduler terminates on queue overflow", "[.][overflow]") {
+
+	reserved_frames frames(512, 8);
+	realtime_scheduler s;
+	s.reserve(2);
+
+	s.policy<reactor_realtime>().set_overflow_callback([](const char* source) { g_overflow_source = source; });
+	std::set_terminate([] { std::_Exit(g_overflow_source == "push" ? EXIT_SUCCESS : EXIT_FAILURE); });
+
+	int resumed = 0;
+	realtime_coroutine a = realtime_frames(resumed);
+	realtime_coroutine b = realtime_frames(resumed);
+	realtime_coroutine c = realtime_frames(resumed);
+	s.push(a);
+	s.push(b);
+	REQUIRE(g_overflow_source.empty());
+
+	s.push(c);
+	FAIL("Queue overflow returned to the caller");
+}
+
+TEST_CASE("Realtime frame pool refuses frames over capacity", "[reactor_realtime]") {
+
+	{
+		reserved_frames frames(512, 1);
+		{
+			int completed = 0;
+			realtime_coroutine a = realtime_spawned(completed);
+			REQUIRE_THROWS_AS(realtime_spawned(completed), std::bad_alloc);
+
+			auto& pool = reactor_realtime::frame_pool();
+			REQUIRE(pool.in_use() == 1);
+			REQUIRE(pool.overflows() == 1);
+		}
+		REQUIRE(reactor_realtime::frame_pool().in_use() == 0);
+	}
+
+	// Frame larger than pool frames is refused the same way
+	{
+		reserved_frames frames(16, 4);
+		int completed = 0;
+		REQUIRE_THROWS_AS(realtime_spawned(completed), std::bad_alloc);
+		REQUIRE(reactor_realtime::frame_pool().overflows() == 1);
+	}
+	REQUIRE(reactor_realtime::frame_pool().capacity() == 0);
+}
@@ -4,6 +4,9 @@
 int main(int argc, char* const argv[]) {
 	int result = Catch::Session().run(argc, argv);
 
+#ifdef _MSC_VER
+	// Keeps console window open when started from Visual Studio
 	while (true);
+#endif
 	return result;
 }
\ No newline at end of file
@@ -0,0 +1,239 @@
+#include "catch.hpp"
+#include <iostream>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+#include "../cppreactor/reactor_actor.hpp"
+
+using namespace cppcoro;
+
+reactor_coroutine<> receive_batches(reactor_mailbox<int>& mailbox, std::vector<std::size_t>& batches, int& sum)
+{
+	for (;;)
+	{
+		auto batch = co_await mailbox.receive_batch();
+		batches.push_back(batch.size());
+		for (auto value : batch)
+		{
+			sum += value;
+		}
+	}
+}
+
+TEST_CASE("Mailbox delivers pending messages in one batch per frame", "[reactor_actor]") {
+
+	reactor_scheduler<> s;
+	reactor_mailbox<int> mailbox(s, 4);
+	std::vector<std::size_t> batches;
+	int sum = 0;
+
+	auto c = receive_batches(mailbox, batches, sum);
+	s.push(c);
+	s.update_next_frame();
+	REQUIRE(batches.empty());
+
+	// More than pool capacity, pool grows
+	for (int i = 1; i <= 10; i++)
+	{
+		mailbox.post(i);
+	}
+	REQUIRE(mailbox.size() == 10);
+
+	s.update_next_frame();
+	REQUIRE(batches.size() == 1);
+	REQUIRE(batches[0] == 10);
+	REQUIRE(sum == 55);
+	REQUIRE(mailbox.empty());
+
+	// Nothing posted, receiver is not resumed
+	s.update_next_frame();
+	REQUIRE(batches.size() == 1);
+
+	mailbox.post(5);
+	mailbox.post(6);
+	s.update_next_frame();
+	REQUIRE(batches.size() == 2);
+	REQUIRE(batches[1] == 2);
+	REQUIRE(sum == 66);
+}
+
+struct counted_message
+{
+	explicit counted_message(int& alive)
+		: m_alive(&alive)
+	{
+		++*m_alive;
+	}
+
+	counted_message(const counted_message&) = delete;
+
+	~counted_message()
+	{
+		--*m_alive;
+	}
+
+	int* m_alive;
+};
+
+TEST_CASE("Mailbox destroys delivered and undelivered messages", "[reactor_actor]") {
+
+	int alive = 0;
+	{
+		reactor_scheduler<> s;
+		reactor_mailbox<counted_message> mailbox(s);
+		mailbox.post(alive);
+		mailbox.post(alive);
+		REQUIRE(alive == 2);
+	}
+	REQUIRE(alive == 0);
+}
+
+class accumulate_actor : public reactor_actor<std::string>
+{
+public:
+	explicit accumulate_actor(reactor_scheduler<>& scheduler)
+		: reactor_actor(scheduler)
+	{
+	}
+
+	std::string m_text;
+
+protected:
+	void receive(std::string& message) override
+	{
+		m_text += message;
+	}
+};
+
+TEST_CASE("Actor handles posted messages", "[reactor_actor]") {
+
+	reactor_scheduler<> s;
+	accumulate_actor actor(s);
+
+	// Posted before loop starts are delivered once it runs
+	actor.post("a");
+	actor.start();
+	actor.post("b");
+
+	s.update_next_frame();
+	s.update_next_frame();
+	REQUIRE(actor.m_text == "ab");
+
+	actor.post("c");
+	s.update_next_frame();
+	REQUIRE(actor.m_text == "abc");
+}
+
+// Actor written the README's way, polls its queue every frame
+reactor_coroutine<> polling_actor(std::deque<int>& queue, long long& sum)
+{
+	for (;;)
+	{
+		while (!queue.empty())
+		{
+			sum += queue.front();
+			queue.pop_front();
+		}
+		co_await next_frame{};
+	}
+}
+
+class sum_actor : public reactor_actor<int>
+{
+public:
+	explicit sum_actor(reactor_scheduler<>& scheduler)
+		: reactor_actor(scheduler)
+	{
+	}
+
+	long long m_sum = 0;
+
+protected:
+	void receive(int& message) override
+	{
+		m_sum += message;
+	}
+};
+
+TEST_CASE("Actor mailbox speed", "[reactor_actor]") {
+
+	const int actors = 1000;
+	const int busy_every = 10; // Only every tenth actor gets messages in a frame
+	const int messages = 8;
+
+#ifdef _DEBUG
+	const int frames = 100;
+#else
+	const int frames = 2000;
+#endif
+
+	double polling_rate = 0;
+	{
+		reactor_scheduler<> s;
+		std::vector<std::deque<int> > queues(actors);
+		std::vector<long long> sums(actors);
+		std::vector<reactor_coroutine<> > coroutines;
+		for (int i = 0; i < actors; i++)
+		{
+			coroutines.push_back(polling_actor(queues[i], sums[i]));
+		}
+		for (auto& c : coroutines)
+		{
+			s.push(c);
+		}
+		s.update_next_frame();
+
+		auto start = std::chrono::high_resolution_clock::now();
+		for (int frame = 0; frame < frames; frame++)
+		{
+			for (int i = frame % busy_every; i < actors; i += busy_every)
+			{
+				for (int m = 0; m < messages; m++)
+				{
+					queues[i].push_back(m);
+				}
+			}
+			s.update_next_frame();
+		}
+		std::chrono::duration<double> duration = std::chrono::high_resolution_clock::now() - start;
+		polling_rate = frames * (actors / busy_every) * messages / duration.count();
+	}
+
+	double mailbox_rate = 0;
+	{
+		reactor_scheduler<> s;
+		std::vector<std::unique_ptr<sum_actor> > sum_actors;
+		for (int i = 0; i < actors; i++)
+		{
+			sum_actors.emplace_back(new sum_actor(s));
+			sum_actors.back()->start();
+		}
+		s.update_next_frame();
+
+		auto start = std::chrono::high_resolution_clock::now();
+		for (int frame = 0; frame < frames; frame++)
+		{
+			for (int i = frame % busy_every; i < actors; i += busy_every)
+			{
+				for (int m = 0; m < messages; m++)
+				{
+					sum_actors[i]->post(m);
+				}
+			}
+			s.update_next_frame();
+		}
+		std::chrono::duration<double> duration = std::chrono::high_resolution_clock::now() - start;
+		mailbox_rate = frames * (actors / busy_every) * messages / duration.count();
+	}
+
+#ifdef _DEBUG
+	const int expectedMinMessages = 10'000;
+#else
+	const int expectedMinMessages = 1'000'000;
+#endif
+
+	std::cout << "Actor messages polling " << polling_rate / 1'000'000 << "M/s, mailbox " << mailbox_rate / 1'000'000 << "M/s" << std::endl;
+	REQUIRE(mailbox_rate > expectedMinMessages);
+}
@@ -0,0 +1,88 @@
+#include "catch.hpp"
+#include <sstream>
+#include <string>
+#include "../cppreactor/reactor_backtrace.hpp"
+
+using namespace cppcoro;
+
+typedef reactor_coroutine<reactor_default_frame_data, reactor_backtrace> traced_coroutine;
+
+// Dump exists only on schedulers with the backtrace policy
+template <class Scheduler>
+constexpr bool has_dump = requires(Scheduler& s, std::ostringstream& out) { s.dump(out); };
+static_assert(has_dump<reactor_scheduler<reactor_default_frame_data, reactor_backtrace> > && !has_dump<reactor_scheduler<> >);
+
+traced_coroutine innermost()
+{
+	co_await next_frame{};
+	co_await next_frame{};
+}
+
+traced_coroutine middle()
+{
+	co_await innermost();
+}
+
+traced_coroutine outer()
+{
+	co_await middle();
+	co_await next_frame{};
+}
+
+static std::size_t count_of(const std::string& text, const std::string& pattern)
+{
+	std::size_t count = 0;
+	for (auto position = text.find(pattern); position != std::string::npos; position = text.find(pattern, position + 1))
+	{
+		count++;
+	}
+	return count;
+}
+
+TEST_CASE("Backtrace dumps awaiter chains", "[reactor_backtrace]") {
+
+	reactor_scheduler<reactor_default_frame_data, reactor_backtrace> s;
+	auto a = outer();
+	auto b = outer();
+	s.push(a);
+	s.push(b);
+
+	{
+		std::ostringstream out;
+		s.dump(out);
+		REQUIRE(count_of(out.str(), "awaits start") == 2);
+	}
+
+	s.update_next_frame();
+	REQUIRE(s.instrumentation<reactor_backtrace>().size() == 6);
+
+	std::ostringstream out;
+	s.dump(out);
+	auto text = out.str();
+
+	REQUIRE(count_of(text, "#0 ") == 2);
+	REQUIRE(count_of(text, "\n  #1 ") == 2);
+	REQUIRE(count_of(text, "\n    #2 ") == 2);
+	REQUIRE(count_of(text, "awaits coroutine") == 4);
+	REQUIRE(count_of(text, "awaits next_frame") == 2);
+#if defined(__cpp_lib_source_location)
+	REQUIRE(count_of(text, "outer") == 2);
+	REQUIRE(count_of(text, "innermost") == 2);
+	REQUIRE(count_of(text, "reactor_backtrace_test.cpp") == 6);
+#endif
+
+	// Children completed, only the roots are left
+	s.update_next_frame();
+	s.update_next_frame();
+	REQUIRE(s.instrumentation<reactor_backtrace>().size() == 2);
+
+	std::ostringstream after;
+	s.dump(after);
+	REQUIRE(count_of(after.str(), "#1") == 0);
+	REQUIRE(count_of(after.str(), "awaits next_frame") == 2);
+
+	s.update_next_frame();
+	std::ostringstream completed;
+	s.dump(completed);
+	REQUIRE(count_of(completed.str(), "awaits completed") == 2);
+}
@@ -1,7 +1,12 @@
 #include "catch.hpp"
 #include <iostream>
 #include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
 #include "../cppreactor/reactor_coroutine.hpp"
+#include "../cppreactor/reactor_stats.hpp"
 
 using namespace cppcoro;
 
@@ -96,6 +101,34 @@ TEST_CASE("Coroutine frame data by ref", "[reactor_coroutine]") {
 	REQUIRE(iteration == 1);
 }
 
+struct empty_frame_struct
+{
+};
+
+reactor_coroutine<empty_frame_struct> single_co_await_empty(int& iteration)
+{
+	iteration = 0;
+	empty_frame_struct frame_data = co_await next_frame<empty_frame_struct>{};
+	(void)frame_data;
+	iteration = 1;
+}
+
+TEST_CASE("Coroutine empty frame data is not stored", "[reactor_coroutine]") {
+
+	static_assert(std::is_empty<detail::reference_to_pointer<reactor_default_frame_data> >::value);
+	static_assert(std::is_empty<detail::reference_to_pointer<empty_frame_struct> >::value);
+
+	reactor_scheduler<empty_frame_struct> s;
+	int iteration = -1;
+	auto c = single_co_await_empty(iteration);
+	s.push(c);
+
+	s.update_next_frame();
+	REQUIRE(iteration == 0);
+	s.update_next_frame(empty_frame_struct{});
+	REQUIRE(iteration == 1);
+}
+
 reactor_coroutine<> infinite_frames()
 {
 	for (;;)
@@ -272,6 +305,103 @@ TEST_CASE("Coroutine return value suspended return", "[reactor_coroutine]") {
 	REQUIRE(data >= 100.0);
 }
 
+// Counts copies and moves, has no default constructor
+struct counted_value
+{
+	static inline int s_copies = 0;
+	static inline int s_moves = 0;
+
+	explicit counted_value(int value)
+		: m_value(value)
+	{
+	}
+
+	counted_value(const counted_value& other)
+		: m_value(other.m_value)
+	{
+		s_copies++;
+	}
+
+	counted_value(counted_value&& other) noexcept
+		: m_value(other.m_value)
+	{
+		s_moves++;
+	}
+
+	int m_value;
+};
+
+reactor_coroutine_return<counted_value> counted_leaf(int value)
+{
+	co_await next_frame{};
+	co_return counted_value(value);
+}
+
+reactor_coroutine_return<counted_value> counted_middle(int value)
+{
+	auto leaf = co_await counted_leaf(value);
+	co_return std::move(leaf);
+}
+
+reactor_coroutine<> counted_root(int& value)
+{
+	auto middle = co_await counted_middle(7);
+	value = middle.m_value;
+}
+
+TEST_CASE("Coroutine return value is moved without copies", "[reactor_coroutine]") {
+
+	reactor_scheduler<> s;
+	int value = 0;
+	counted_value::s_copies = 0;
+	counted_value::s_moves = 0;
+
+	auto c = counted_root(value);
+	s.push(c);
+	s.update_next_frame();
+	s.update_next_frame();
+
+	REQUIRE(value == 7);
+	REQUIRE(counted_value::s_copies == 0);
+
+	// Into the promise and out to the awaiter at each level
+	REQUIRE(counted_value::s_moves == 4);
+}
+
+reactor_coroutine_return<std::unique_ptr<int> > unique_leaf(int value)
+{
+	co_await next_frame{};
+	co_return std::make_unique<int>(value);
+}
+
+reactor_coroutine_return<int&> reference_leaf(int& value)
+{
+	co_return value;
+}
+
+reactor_coroutine<> move_only_root(int& result, int& target)
+{
+	auto pointer = co_await unique_leaf(5);
+	result = *pointer;
+
+	int& reference = co_await reference_leaf(target);
+	reference = result;
+}
+
+TEST_CASE("Coroutine returns move-only values and references", "[reactor_coroutine]") {
+
+	reactor_scheduler<> s;
+	int result = 0;
+	int target = 0;
+
+	auto c = move_only_root(result, target);
+	s.push(c);
+	s.update_next_frame();
+	s.update_next_frame();
+
+	REQUIRE(result == 5);
+	REQUIRE(target == 5);
+}
 
 reactor_coroutine<> exception_coroutine()
 {
@@ -322,3 +452,624 @@ TEST_CASE("Coroutine throws exception inside", "[reactor_coroutine]") {
 
 	REQUIRE(caught == true);
 }
+
+// Parameter copies live in coroutine frame until it is destroyed
+reactor_coroutine<> hold_token(std::shared_ptr<int> token)
+{
+	co_await next_frame{};
+}
+
+TEST_CASE("Coroutine frame is released by owner", "[reactor_coroutine]") {
+
+	reactor_scheduler<> s;
+	auto token = std::make_shared<int>(0);
+	{
+		auto c = hold_token(token);
+		s.push(c);
+		s.update_next_frame();
+		REQUIRE(!c.done());
+		s.update_next_frame();
+		REQUIRE(c.done());
+		REQUIRE(token.use_count() == 2);
+	}
+	REQUIRE(token.use_count() == 1);
+}
+
+reactor_coroutine<> complete_immediately(int& completed)
+{
+	completed++;
+	co_return;
+}
+
+reactor_coroutine<> await_completed_child(int& completed, int& resumed)
+{
+	co_await complete_immediately(completed);
+	resumed++;
+	co_await next_frame{};
+	resumed++;
+}
+
+TEST_CASE("Coroutine child completing synchronously resumes parent once", "[reactor_coroutine]") {
+
+	reactor_scheduler<> s;
+	int completed = 0;
+	int resumed = 0;
+
+	auto c = await_completed_child(completed, resumed);
+	s.push(c);
+	s.update_next_frame();
+	REQUIRE(completed == 1);
+	REQUIRE(resumed == 1);
+
+	s.update_next_frame();
+	REQUIRE(resumed == 2);
+	s.update_next_frame();
+	REQUIRE(resumed == 2);
+}
+
+TEST_CASE("Coroutine spawn speed", "[reactor_coroutine]") {
+
+#ifdef _DEBUG
+	const int frames = 100;
+#else
+	const int frames = 2000;
+#endif
+	const int per_frame = 10'000;
+
+	reactor_scheduler<> s;
+	std::vector<reactor_coroutine<> > coroutines(per_frame);
+	int completed = 0;
+
+	auto start = std::chrono::high_resolution_clock::now();
+	for (int frame = 0; frame < frames; frame++)
+	{
+		for (auto& c : coroutines)
+		{
+			c = complete_immediately(completed);
+			s.push(c);
+		}
+		s.update_next_frame();
+	}
+	std::chrono::duration<double> duration = std::chrono::high_resolution_clock::now() - start;
+
+#ifdef _DEBUG
+	const int expectedMinSpawns = 10'000;
+#else
+	const int expectedMinSpawns = 1'000'000;
+#endif
+
+	auto spawns_per_second = completed / duration.count();
+
+	std::cout << "Coroutine spawns " << spawns_per_second / 1'000'000 << "M/s" << std::endl;
+	REQUIRE(completed == frames * per_frame);
+	REQUIRE(spawns_per_second > expectedMinSpawns);
+}
+
+typedef reactor_coroutine<reactor_default_frame_data, reactor_intrusive_queue> intrusive_coroutine;
+typedef reactor_scheduler<reactor_default_frame_data, reactor_intrusive_queue> intrusive_scheduler;
+
+intrusive_coroutine intrusive_child(std::vector<int>& order, int id)
+{
+	co_await next_frame{};
+	order.push_back(id);
+}
+
+intrusive_coroutine intrusive_parent(std::vector<int>& order, int id)
+{
+	order.push_back(id);
+	co_await intrusive_child(order, id + 10);
+	co_await next_frame{};
+	order.push_back(id);
+}
+
+TEST_CASE("Coroutine intrusive queue keeps resume order", "[reactor_coroutine]") {
+
+	intrusive_scheduler s;
+	std::vector<int> order;
+
+	auto a = intrusive_parent(order, 1);
+	auto b = intrusive_parent(order, 2);
+	s.push(a);
+	s.push(b);
+
+	s.update_next_frame();
+	REQUIRE(order == std::vector<int>{ 1, 2 });
+	s.update_next_frame();
+	REQUIRE(order == std::vector<int>{ 1, 2, 11, 12 });
+	s.update_next_frame();
+	REQUIRE(order == std::vector<int>{ 1, 2, 11, 12, 1, 2 });
+	REQUIRE(a.done());
+	REQUIRE(b.done());
+}
+
+typedef reactor_scheduler<reactor_default_frame_data, reactor_stats, reactor_intrusive_queue> stats_intrusive_scheduler;
+
+reactor_coroutine<reactor_default_frame_data, reactor_stats, reactor_intrusive_queue> await_spelled_next_frame(int& resumes)
+{
+	co_await next_frame<reactor_default_frame_data, reactor_stats, reactor_intrusive_queue>{};
+	resumes++;
+	co_await next_frame{};
+	resumes++;
+}
+
+TEST_CASE("Coroutine awaits next_frame spelled with its policies", "[reactor_coroutine]") {
+
+	stats_intrusive_scheduler s;
+	int resumes = 0;
+
+	auto c = await_spelled_next_frame(resumes);
+	s.push(c);
+
+	s.update_next_frame();
+	REQUIRE(resumes == 0);
+	s.update_next_frame();
+	REQUIRE(resumes == 1);
+	s.update_next_frame();
+	REQUIRE(resumes == 2);
+	REQUIRE(c.done());
+}
+
+// Waits on an external event, every waiter keeps its node in its own frame
+struct intrusive_event
+{
+	reactor_frame_list m_waiters;
+
+	struct awaitable
+	{
+		intrusive_event* m_event;
+		reactor_frame_node m_node;
+
+		bool await_ready() const noexcept
+		{
+			return false;
+		}
+
+		void await_suspend(detail::coro::coroutine_handle<> awaitingCoroutine)
+		{
+			m_node.m_handle = awaitingCoroutine;
+			m_event->m_waiters.push_back(m_node);
+		}
+
+		void await_resume()
+		{
+		}
+	};
+
+	awaitable wait()
+	{
+		return { this, {} };
+	}
+};
+
+intrusive_coroutine wait_for_event(intrusive_event& event, int& woken)
+{
+	co_await event.wait();
+	woken++;
+}
+
+TEST_CASE("Coroutine intrusive queue wakes waiter list at once", "[reactor_coroutine]") {
+
+	intrusive_scheduler s;
+	intrusive_event event;
+	int woken = 0;
+
+	std::vector<intrusive_coroutine> waiters;
+	for (int i = 0; i < 100; i++)
+	{
+		waiters.push_back(wait_for_event(event, woken));
+		s.push(waiters.back());
+	}
+	s.update_next_frame();
+	REQUIRE(event.m_waiters.size() == 100);
+
+	s.enqueue_update(event.m_waiters);
+	REQUIRE(event.m_waiters.empty());
+	REQUIRE(woken == 0);
+
+	s.update_next_frame();
+	REQUIRE(woken == 100);
+}
+
+intrusive_coroutine intrusive_throw_after_frame(int& resumed)
+{
+	co_await next_frame{};
+	resumed++;
+	throw std::exception();
+}
+
+intrusive_coroutine intrusive_count_frames(int& resumed)
+{
+	for (;;)
+	{
+		co_await next_frame{};
+		resumed++;
+	}
+}
+
+TEST_CASE("Coroutine intrusive queue keeps nodes after exception", "[reactor_coroutine]") {
+
+	intrusive_scheduler s;
+	int resumed = 0;
+
+	auto a = intrusive_throw_after_frame(resumed);
+	auto b = intrusive_count_frames(resumed);
+	auto c = intrusive_count_frames(resumed);
+	s.push(a);
+	s.push(b);
+	s.push(c);
+	s.update_next_frame();
+
+	REQUIRE_THROWS(s.update_next_frame());
+	REQUIRE(resumed == 1);
+
+	// Both handles after the throwing one are resumed in the next frame
+	s.update_next_frame();
+	REQUIRE(resumed == 3);
+	s.update_next_frame();
+	REQUIRE(resumed == 5);
+}
+
+typedef reactor_coroutine<reactor_default_frame_data, reactor_grouped_queue> grouped_coroutine;
+
+grouped_coroutine grouped_kind_a(std::vector<int>& order, int id)
+{
+	for (;;)
+	{
+		co_await next_frame{};
+		order.push_back(id);
+	}
+}
+
+grouped_coroutine grouped_kind_b(std::vector<int>& order, int id)
+{
+	for (;;)
+	{
+		co_await next_frame{};
+		order.push_back(-id);
+	}
+}
+
+TEST_CASE("Coroutine grouped queue resumes same kinds together", "[reactor_coroutine]") {
+
+	reactor_scheduler<reactor_default_frame_data, reactor_grouped_queue> s;
+	std::vector<int> order;
+
+	std::vector<grouped_coroutine> coroutines;
+	for (int i = 1; i <= 3; i++)
+	{
+		coroutines.push_back(grouped_kind_a(order, i));
+		coroutines.push_back(grouped_kind_b(order, i));
+	}
+	for (auto& c : coroutines)
+	{
+		s.push(c);
+	}
+
+	s.update_next_frame();
+	REQUIRE(order.empty());
+
+	// Kinds are grouped in the order the scheduler first queued them, each group keeps queue order
+	s.update_next_frame();
+	REQUIRE(order == std::vector<int>{ 1, 2, 3, -1, -2, -3 });
+
+	order.clear();
+	s.update_next_frame();
+	REQUIRE(order == std::vector<int>{ 1, 2, 3, -1, -2, -3 });
+}
+
+struct counting_frames : public reactor_frame_allocator
+{
+	static inline std::size_t s_allocations = 0;
+	static inline std::size_t s_releases = 0;
+
+	static void* allocate_frame(std::size_t size)
+	{
+		++s_allocations;
+		return ::operator new(size);
+	}
+
+	static void deallocate_frame(void* frame, std::size_t) noexcept
+	{
+		++s_releases;
+		::operator delete(frame);
+	}
+};
+
+reactor_coroutine<reactor_default_frame_data, counting_frames> allocator_loop(int& iteration)
+{
+	for (;;)
+	{
+		co_await next_frame{};
+		iteration++;
+	}
+}
+
+TEST_CASE("Coroutine frame allocator policy allocates frames", "[reactor_coroutine]") {
+
+	// Frame allocator alone has no state in the scheduler
+	static_assert(sizeof(reactor_scheduler<reactor_default_frame_data, counting_frames>) == sizeof(reactor_scheduler<>));
+
+	reactor_scheduler<reactor_default_frame_data, counting_frames> s;
+	int iteration = 0;
+	{
+		auto c = allocator_loop(iteration);
+		REQUIRE(counting_frames::s_allocations == 1);
+		s.push(c);
+		s.update_next_frame();
+		s.update_next_frame();
+		REQUIRE(iteration == 1);
+	}
+	REQUIRE(counting_frames::s_releases == 1);
+}
+
+struct record_errors : public reactor_error_policy
+{
+	std::vector<const void*> m_coroutines;
+
+	void on_unhandled_exception(const void* coroutine)
+	{
+		m_coroutines.push_back(coroutine);
+	}
+};
+
+typedef reactor_coroutine<reactor_default_frame_data, record_errors> error_coroutine;
+
+error_coroutine error_throw_after_frame()
+{
+	co_await next_frame{};
+	throw std::runtime_error("failed");
+}
+
+error_coroutine error_count(int& iteration)
+{
+	for (;;)
+	{
+		co_await next_frame{};
+		iteration++;
+	}
+}
+
+TEST_CASE("Coroutine error policy completes throwing coroutine", "[reactor_coroutine]") {
+
+	reactor_scheduler<reactor_default_frame_data, record_errors> s;
+	int iteration = 0;
+	auto thrower = error_throw_after_frame();
+	auto counter = error_count(iteration);
+	s.push(thrower);
+	s.push(counter);
+
+	s.update_next_frame();
+	REQUIRE_NOTHROW(s.update_next_frame());
+	REQUIRE(thrower.done());
+	REQUIRE(s.policy<record_errors>().m_coroutines.size() == 1);
+
+	// Rest of the frame went on
+	REQUIRE(iteration == 1);
+	s.update_next_frame();
+	REQUIRE(iteration == 2);
+}
+
+typedef reactor_scheduler<reactor_default_frame_data, reactor_thread_safe_enqueue> thread_safe_scheduler;
+
+struct wake_from_thread
+{
+	thread_safe_scheduler& m_scheduler;
+	std::thread& m_thread;
+
+	bool await_ready() const noexcept
+	{
+		return false;
+	}
+
+	void await_suspend(detail::coro::coroutine_handle<> handle)
+	{
+		m_thread = std::thread([this, handle]() { m_scheduler.enqueue_update(handle, "thread"); });
+	}
+
+	void await_resume() const noexcept
+	{
+	}
+};
+
+reactor_coroutine<reactor_default_frame_data, reactor_thread_safe_enqueue> wait_thread(thread_safe_scheduler& s, std::thread& thread, bool& woken)
+{
+	co_await wake_from_thread{ s, thread };
+	woken = true;
+}
+
+TEST_CASE("Coroutine thread safe scheduler takes handles from other threads", "[reactor_coroutine]") {
+
+	thread_safe_scheduler s;
+	std::thread thread;
+	bool woken = false;
+	auto c = wait_thread(s, thread, woken);
+	s.push(c);
+	s.update_next_frame();
+
+	auto start = std::chrono::steady_clock::now();
+	while (!woken && std::chrono::steady_clock::now() - start < std::chrono::seconds(10))
+	{
+		s.update_next_frame();
+	}
+	thread.join();
+	REQUIRE(woken);
+}
+
+reactor_shared_coroutine_return<std::unique_ptr<int> > shared_lookup(int& runs, int value)
+{
+	runs++;
+	co_await next_frame{};
+	co_await next_frame{};
+	co_return std::make_unique<int>(value);
+}
+
+reactor_coroutine<> shared_reader(reactor_shared_coroutine_return<std::unique_ptr<int> > lookup, std::vector<int>& values)
+{
+	const auto& value = co_await lookup;
+	values.push_back(*value);
+}
+
+TEST_CASE("Coroutine shared return runs once for all awaiters", "[reactor_coroutine]") {
+
+	reactor_scheduler<> s;
+	int runs = 0;
+	std::vector<int> values;
+
+	auto lookup = shared_lookup(runs, 42);
+	REQUIRE(runs == 0);
+
+	std::vector<reactor_coroutine<> > readers;
+	for (int i = 0; i < 3; i++)
+	{
+		readers.push_back(shared_reader(lookup, values));
+	}
+	for (auto& reader : readers)
+	{
+		s.push(reader);
+	}
+
+	// First reader starts it, all of them wait
+	s.update_next_frame();
+	REQUIRE(runs == 1);
+	s.update_next_frame();
+	s.update_next_frame();
+	REQUIRE(lookup.done());
+	REQUIRE(values.empty());
+
+	// Awaiters are resumed together in the frame after completion
+	s.update_next_frame();
+	REQUIRE(values == std::vector<int>{ 42, 42, 42 });
+
+	// Later awaiter gets the value without suspending
+	auto late = shared_reader(lookup, values);
+	s.push(late);
+	s.update_next_frame();
+	REQUIRE(values.size() == 4);
+	REQUIRE(late.done());
+	REQUIRE(runs == 1);
+}
+
+reactor_shared_coroutine_return<int> shared_failure()
+{
+	co_await next_frame{};
+	throw std::runtime_error("lookup failed");
+}
+
+reactor_coroutine<> shared_catch(reactor_shared_coroutine_return<int> lookup, int& caught)
+{
+	try
+	{
+		co_await lookup;
+	}
+	catch (const std::runtime_error&)
+	{
+		caught++;
+	}
+}
+
+TEST_CASE("Coroutine shared return rethrows to every awaiter", "[reactor_coroutine]") {
+
+	reactor_scheduler<> s;
+	int caught = 0;
+	auto lookup = shared_failure();
+	auto a = shared_catch(lookup, caught);
+	auto b = shared_catch(lookup, caught);
+	s.push(a);
+	s.push(b);
+
+	for (int i = 0; i < 3; i++)
+	{
+		s.update_next_frame();
+	}
+	REQUIRE(caught == 2);
+}
+
+reactor_generator<int> generate_over_frames(int count)
+{
+	for (int i = 0; i < count; i++)
+	{
+		co_yield i;
+
+		// Two values each frame
+		if (i % 2 == 1)
+		{
+			co_await next_frame{};
+		}
+	}
+}
+
+reactor_coroutine<> consume_values(std::vector<int>& values)
+{
+	auto generator = generate_over_frames(5);
+	while (int* value = co_await generator.next())
+	{
+		values.push_back(*value);
+	}
+	values.push_back(-1);
+}
+
+TEST_CASE("Coroutine generator yields values across frames", "[reactor_coroutine]") {
+
+	reactor_scheduler<> s;
+	std::vector<int> values;
+	auto c = consume_values(values);
+	s.push(c);
+
+	s.update_next_frame();
+	REQUIRE(values == std::vector<int>{ 0, 1 });
+	s.update_next_frame();
+	REQUIRE(values == std::vector<int>{ 0, 1, 2, 3 });
+	s.update_next_frame();
+	REQUIRE(values == std::vector<int>{ 0, 1, 2, 3, 4, -1 });
+	REQUIRE(c.done());
+}
+
+reactor_coroutine_return<int> generator_child(int value)
+{
+	co_await next_frame{};
+	co_return value * 10;
+}
+
+reactor_generator<std::unique_ptr<int> > generate_owned(int count)
+{
+	for (int i = 0; i < count; i++)
+	{
+		co_yield std::make_unique<int>(co_await generator_child(i));
+	}
+	throw std::runtime_error("generator failed");
+}
+
+reactor_coroutine<> consume_owned(std::vector<int>& values, bool& caught)
+{
+	auto generator = generate_owned(3);
+	try
+	{
+		while (auto value = co_await generator.next())
+		{
+			// Moving out leaves nothing behind in the generator
+			auto owned = std::move(*value);
+			values.push_back(*owned);
+		}
+	}
+	catch (const std::runtime_error&)
+	{
+		caught = true;
+	}
+}
+
+TEST_CASE("Coroutine generator awaits children and rethrows to consumer", "[reactor_coroutine]") {
+
+	reactor_scheduler<> s;
+	std::vector<int> values;
+	bool caught = false;
+	auto c = consume_owned(values, caught);
+	s.push(c);
+
+	for (int i = 0; i < 5; i++)
+	{
+		s.update_next_frame();
+	}
+	REQUIRE(values == std::vector<int>{ 0, 10, 20 });
+	REQUIRE(caught);
+	REQUIRE(c.done());
+}
@@ -0,0 +1,88 @@
+#include "catch.hpp"
+#include <memory>
+#include <string>
+#include "../cppreactor/reactor_expected.hpp"
+
+using namespace cppcoro;
+
+enum class load_error
+{
+	missing,
+	corrupt
+};
+
+typedef reactor_scheduler<reactor_default_frame_data, reactor_no_exceptions> quiet_scheduler;
+typedef reactor_coroutine<reactor_default_frame_data, reactor_no_exceptions> quiet_coroutine;
+
+template <class R>
+using quiet_result = reactor_coroutine_return<reactor_expected<R, load_error>, reactor_default_frame_data, reactor_no_exceptions>;
+
+quiet_result<int> read_size(int size)
+{
+	co_await next_frame{};
+	if (size < 0)
+	{
+		co_return reactor_unexpected(load_error::corrupt);
+	}
+	co_return size;
+}
+
+quiet_result<std::unique_ptr<std::string> > read_name(int size)
+{
+	auto read = co_await read_size(size);
+	if (!read)
+	{
+		co_return reactor_unexpected(read.error());
+	}
+	co_return std::make_unique<std::string>(*read, 'x');
+}
+
+quiet_coroutine load(int size, reactor_expected<std::size_t, load_error>& result)
+{
+	auto name = co_await read_name(size);
+	if (!name)
+	{
+		result = reactor_unexpected(name.error());
+		co_return;
+	}
+	result = (*name)->size();
+}
+
+TEST_CASE("Expected value is returned through nested awaits", "[reactor_expected]") {
+
+	quiet_scheduler s;
+	reactor_expected<std::size_t, load_error> result = reactor_unexpected(load_error::missing);
+
+	auto c = load(3, result);
+	s.push(c);
+	s.update_next_frame();
+	s.update_next_frame();
+
+	REQUIRE(c.done());
+	REQUIRE(result.has_value());
+	REQUIRE(result.value() == 3);
+}
+
+TEST_CASE("Expected error is returned through nested awaits", "[reactor_expected]") {
+
+	quiet_scheduler s;
+	reactor_expected<std::size_t, load_error> result = 0;
+
+	auto c = load(-1, result);
+	s.push(c);
+	s.update_next_frame();
+	s.update_next_frame();
+
+	REQUIRE(c.done());
+	REQUIRE(!result);
+	REQUIRE(result.error() == load_error::corrupt);
+}
+
+TEST_CASE("Expected coroutines keep no exception in the promise", "[reactor_expected]") {
+
+	typedef detail::reactor_coroutine_promise_return<int, reactor_default_frame_data> throwing_promise;
+	typedef detail::reactor_coroutine_promise_return<int, reactor_default_frame_data, reactor_no_exceptions> quiet_promise;
+	static_assert(sizeof(quiet_promise) < sizeof(throwing_promise));
+	static_assert(!quiet_scheduler::exceptions);
+	static_assert(reactor_scheduler<>::exceptions);
+}
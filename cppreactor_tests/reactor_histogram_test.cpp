@@ -0,0 +1,101 @@
+#include "catch.hpp"
+#include <chrono>
+#include <iostream>
+#include <limits>
+#include <vector>
+#include "../cppreactor/reactor_histogram.hpp"
+
+using namespace cppcoro;
+
+TEST_CASE("Histogram percentiles", "[reactor_histogram]") {
+
+	reactor_histogram h;
+	REQUIRE(h.percentile(50) == 0);
+
+	for (std::uint64_t v = 1; v <= 100'000; v++)
+	{
+		h.record(v);
+	}
+
+	REQUIRE(h.count() == 100'000);
+	REQUIRE(h.min() == 1);
+	REQUIRE(h.max() == 100'000);
+	REQUIRE(h.mean() == Approx(50'000.5));
+
+	// Buckets are about 3% wide
+	REQUIRE(h.percentile(50) >= 50'000);
+	REQUIRE(h.percentile(50) <= 51'600);
+	REQUIRE(h.percentile(99) >= 99'000);
+	REQUIRE(h.percentile(99) <= 100'000);
+	REQUIRE(h.percentile(99.9) >= 99'900);
+	REQUIRE(h.percentile(100) == 100'000);
+
+	// Small values are exact
+	reactor_histogram small;
+	for (std::uint64_t v = 0; v < 32; v++)
+	{
+		small.record(v);
+	}
+	REQUIRE(small.percentile(50) == 15);
+
+	h.reset();
+	REQUIRE(h.count() == 0);
+	h.record(std::numeric_limits<std::uint64_t>::max());
+	REQUIRE(h.percentile(50) == std::numeric_limits<std::uint64_t>::max());
+}
+
+typedef reactor_coroutine<reactor_default_frame_data, reactor_frame_histogram> histogram_coroutine;
+
+histogram_coroutine spin_on_frame(int frame, std::chrono::microseconds busy)
+{
+	for (int i = 0;; i++)
+	{
+		if (i == frame)
+		{
+			auto end = std::chrono::steady_clock::now() + busy;
+			while (std::chrono::steady_clock::now() < end)
+			{
+			}
+		}
+		co_await next_frame{};
+	}
+}
+
+TEST_CASE("Frame histogram reports hitches with slowest resumes", "[reactor_histogram]") {
+
+	reactor_scheduler<reactor_default_frame_data, reactor_frame_histogram> s;
+	auto& histogram = s.instrumentation<reactor_frame_histogram>();
+
+	std::vector<reactor_frame_hitch> hitches;
+	histogram.set_hitch_threshold(std::chrono::milliseconds(5), [&hitches](const reactor_frame_hitch& hitch) { hitches.push_back(hitch); });
+
+	std::vector<histogram_coroutine> coroutines;
+	for (int i = 0; i < 10; i++)
+	{
+		coroutines.push_back(spin_on_frame(-1, std::chrono::microseconds(0)));
+	}
+	coroutines.push_back(spin_on_frame(3, std::chrono::milliseconds(10)));
+	for (auto& c : coroutines)
+	{
+		s.push(c);
+	}
+
+	for (int i = 0; i < 10; i++)
+	{
+		s.update_next_frame();
+	}
+
+	REQUIRE(histogram.frame_times().count() == 10);
+	REQUIRE(histogram.queue_lengths().percentile(50) == 11);
+	REQUIRE(histogram.starts().max() == 11);
+	REQUIRE(histogram.starts().percentile(50) == 0);
+	REQUIRE(histogram.frame_times().percentile(100) >= 10'000'000);
+
+	REQUIRE(histogram.hitches() == 1);
+	REQUIRE(hitches.size() == 1);
+	REQUIRE(hitches[0].m_frame == 4);
+	REQUIRE(hitches[0].m_queued == 11);
+	REQUIRE(hitches[0].m_slowest.size() == 8);
+	REQUIRE(hitches[0].m_slowest[0].m_duration >= std::chrono::milliseconds(10));
+	REQUIRE(hitches[0].m_slowest[1].m_duration < std::chrono::milliseconds(5));
+}
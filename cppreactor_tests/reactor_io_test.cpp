@@ -0,0 +1,194 @@
+#include "catch.hpp"
+#include "../cppreactor/reactor_io.hpp"
+
+#ifdef __linux__
+
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <fcntl.h>
+
+using namespace cppcoro;
+
+namespace
+{
+	struct temporary_file
+	{
+		temporary_file()
+		{
+			char path[] = "/tmp/cppreactor_io_XXXXXX";
+			fd = mkstemp(path);
+			name = path;
+		}
+
+		~temporary_file()
+		{
+			::close(fd);
+			::unlink(name.c_str());
+		}
+
+		int fd;
+		std::string name;
+	};
+
+	// Kernel may complete operations asynchronously, give it real time instead of a frame count
+	template <class F>
+	void update_until(reactor_scheduler<>& s, F done)
+	{
+		for (int i = 0; i < 5000 && !done(); i++)
+		{
+			s.update_next_frame();
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+		}
+	}
+}
+
+reactor_coroutine<> write_then_read(reactor_io<>& io, int fd, std::string& result)
+{
+	const char text[] = "reactor io";
+	auto written = co_await io.write(fd, text, sizeof(text), 0);
+	REQUIRE(written == sizeof(text));
+
+	char buffer[sizeof(text)] = {};
+	auto read = co_await io.read(fd, buffer, sizeof(buffer), 0);
+	REQUIRE(read == sizeof(text));
+
+	result = buffer;
+}
+
+void run_file_test(reactor_io_backend backend)
+{
+	reactor_scheduler<> s;
+	reactor_io<> io(s, 64, backend);
+	temporary_file file;
+	std::string result;
+
+	auto c = write_then_read(io, file.fd, result);
+	s.push(c);
+
+	update_until(s, [&] { return !result.empty(); });
+	REQUIRE(result == "reactor io");
+}
+
+TEST_CASE("IO file read and write", "[reactor_io]") {
+
+	run_file_test(reactor_io_backend::io_uring);
+	run_file_test(reactor_io_backend::synchronous);
+}
+
+TEST_CASE("IO synchronous backend completes in next frame", "[reactor_io]") {
+
+	reactor_scheduler<> s;
+	reactor_io<> io(s, 64, reactor_io_backend::synchronous);
+	REQUIRE(io.backend() == reactor_io_backend::synchronous);
+
+	temporary_file file;
+	std::string result;
+	auto c = write_then_read(io, file.fd, result);
+	s.push(c);
+
+	// Start and submit write, resume after write and submit read, resume after read
+	s.update_next_frame();
+	s.update_next_frame();
+	REQUIRE(result.empty());
+	s.update_next_frame();
+	REQUIRE(result == "reactor io");
+}
+
+reactor_coroutine<> receive_message(reactor_io<>& io, int fd, std::string& result)
+{
+	char buffer[16] = {};
+	auto size = co_await io.recv(fd, buffer, sizeof(buffer));
+	result.assign(buffer, size);
+}
+
+reactor_coroutine<> send_message(reactor_io<>& io, int fd, int delay_frames)
+{
+	for (int i = 0; i < delay_frames; i++)
+		co_await next_frame{};
+
+	co_await io.send(fd, "ping", 4);
+}
+
+void run_socket_test(reactor_io_backend backend)
+{
+	int sockets[2];
+	REQUIRE(::socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) == 0);
+
+	reactor_scheduler<> s;
+	reactor_io<> io(s, 64, backend);
+	std::string result;
+
+	auto receiver = receive_message(io, sockets[0], result);
+	auto sender = send_message(io, sockets[1], 5);
+	s.push(receiver);
+	s.push(sender);
+
+	update_until(s, [&] { return !result.empty(); });
+	REQUIRE(result == "ping");
+
+	::close(sockets[0]);
+	::close(sockets[1]);
+}
+
+TEST_CASE("IO socket receive waits for data", "[reactor_io]") {
+
+	run_socket_test(reactor_io_backend::io_uring);
+	run_socket_test(reactor_io_backend::synchronous);
+}
+
+TEST_CASE("IO destruction cancels operations in flight", "[reactor_io]") {
+
+	int sockets[2];
+	REQUIRE(::socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) == 0);
+
+	reactor_scheduler<> s;
+	std::string result;
+	{
+		auto io = std::make_unique<reactor_io<>>(s, 64);
+		REQUIRE(io->backend() == reactor_io_backend::io_uring);
+
+		// Receive buffer lives in coroutine frame, which outlives the io
+		auto receiver = receive_message(*io, sockets[0], result);
+		s.push(receiver);
+		s.update_next_frame();
+		s.update_next_frame();
+
+		// Nothing is ever sent, destruction must not wait for the receive
+		io.reset();
+	}
+	REQUIRE(result.empty());
+
+	::close(sockets[0]);
+	::close(sockets[1]);
+}
+
+reactor_coroutine<> read_invalid(reactor_io<>& io, bool& caught)
+{
+	char buffer[4];
+	try {
+		co_await io.read(-1, buffer, sizeof(buffer), 0);
+	}
+	catch (std::system_error&)
+	{
+		caught = true;
+	}
+}
+
+TEST_CASE("IO errors are thrown", "[reactor_io]") {
+
+	reactor_scheduler<> s;
+	reactor_io<> io(s);
+	bool caught = false;
+
+	auto c = read_invalid(io, caught);
+	s.push(c);
+
+	update_until(s, [&] { return caught; });
+	REQUIRE(caught == true);
+}
+
+#endif
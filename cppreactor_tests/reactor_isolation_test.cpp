@@ -0,0 +1,97 @@
+#include "catch.hpp"
+#include <stdexcept>
+#include <vector>
+#include "../cppreactor/reactor_isolation.hpp"
+
+using namespace cppcoro;
+
+typedef reactor_scheduler<reactor_default_frame_data, reactor_isolate_errors> isolated_scheduler;
+typedef reactor_coroutine<reactor_default_frame_data, reactor_isolate_errors> isolated_coroutine;
+
+isolated_coroutine isolated_child(bool fail)
+{
+	co_await next_frame{};
+	if (fail)
+	{
+		throw std::runtime_error("child failed");
+	}
+}
+
+isolated_coroutine isolated_worker(int index, std::vector<int>& counts)
+{
+	for (;;)
+	{
+		co_await next_frame{};
+		counts[index]++;
+
+		// Every 100th fails in the second frame, from an awaited child
+		co_await isolated_child(index % 100 == 0 && counts[index] == 2);
+	}
+}
+
+TEST_CASE("Isolation keeps the frame going after failures", "[reactor_isolation]") {
+
+	isolated_scheduler s;
+	auto& errors = s.policy<reactor_isolate_errors>();
+
+	const int count = 1000;
+	std::vector<int> counts(count);
+	std::vector<isolated_coroutine> coroutines;
+	for (int i = 0; i < count; i++)
+	{
+		coroutines.push_back(isolated_worker(i, counts));
+	}
+	for (auto& c : coroutines)
+	{
+		s.push(c);
+	}
+
+	for (int frame = 0; frame < 6; frame++)
+	{
+		REQUIRE_NOTHROW(s.update_next_frame());
+	}
+
+	// Failures were reported in the frame the children threw
+	REQUIRE(errors.total_failures() == 10);
+	REQUIRE(errors.failures().empty());
+
+	for (int i = 0; i < count; i++)
+	{
+		REQUIRE(coroutines[i].done() == (i % 100 == 0));
+		REQUIRE(counts[i] == (i % 100 == 0 ? 2 : 3));
+	}
+}
+
+isolated_coroutine isolated_throw_now(int& resumed)
+{
+	resumed++;
+	throw std::logic_error("failed");
+	co_await next_frame{};
+}
+
+TEST_CASE("Isolation reports failures of the latest frame", "[reactor_isolation]") {
+
+	isolated_scheduler s;
+	auto& errors = s.policy<reactor_isolate_errors>();
+
+	std::vector<const void*> reported;
+	errors.set_failure_callback([&](const reactor_coroutine_failure& failure) { reported.push_back(failure.m_coroutine); });
+
+	int resumed = 0;
+	auto a = isolated_throw_now(resumed);
+	auto b = isolated_throw_now(resumed);
+	s.push(a);
+	s.push(b);
+	s.update_next_frame();
+
+	REQUIRE(resumed == 2);
+	REQUIRE(errors.frame() == 1);
+	REQUIRE(errors.failures().size() == 2);
+	REQUIRE(reported.size() == 2);
+	REQUIRE(errors.failures()[0].m_coroutine == reported[0]);
+	REQUIRE_THROWS_AS(std::rethrow_exception(errors.failures()[1].m_exception), std::logic_error);
+
+	s.update_next_frame();
+	REQUIRE(errors.failures().empty());
+	REQUIRE(errors.total_failures() == 2);
+}
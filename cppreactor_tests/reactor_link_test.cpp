@@ -0,0 +1,152 @@
+#include "catch.hpp"
+#include <atomic>
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "../cppreactor/reactor_link.hpp"
+
+using namespace cppcoro;
+
+reactor_coroutine<> receive_link(reactor_link<int>& link, std::vector<int>& received, int& resumes)
+{
+	for (;;)
+	{
+		auto batch = co_await link.receive_batch();
+		resumes++;
+		for (auto value : batch)
+		{
+			received.push_back(value);
+		}
+	}
+}
+
+TEST_CASE("Link publishes sends at end of sender frame", "[reactor_link]") {
+
+	reactor_scheduler<> sender;
+	reactor_scheduler<> receiver;
+	reactor_link<int> link(sender, receiver, 4);
+	REQUIRE(link.capacity() == 4);
+
+	std::vector<int> received;
+	int resumes = 0;
+	auto c = receive_link(link, received, resumes);
+	receiver.push(c);
+	receiver.update_next_frame();
+
+	REQUIRE(link.send(1));
+	REQUIRE(link.send(2));
+
+	// Not published yet
+	receiver.update_next_frame();
+	REQUIRE(received.empty());
+
+	sender.update_next_frame();
+	receiver.update_next_frame();
+	REQUIRE(received == std::vector<int>{ 1, 2 });
+	REQUIRE(resumes == 1);
+
+	// Nothing sent, receiver stays suspended
+	sender.update_next_frame();
+	receiver.update_next_frame();
+	REQUIRE(resumes == 1);
+}
+
+TEST_CASE("Link send fails when ring is full", "[reactor_link]") {
+
+	reactor_scheduler<> sender;
+	reactor_scheduler<> receiver;
+	reactor_link<int> link(sender, receiver, 2);
+
+	std::vector<int> received;
+	int resumes = 0;
+	auto c = receive_link(link, received, resumes);
+	receiver.push(c);
+	receiver.update_next_frame();
+
+	REQUIRE(link.send(1));
+	REQUIRE(link.send(2));
+	REQUIRE(link.send(3) == false);
+
+	sender.update_next_frame();
+	receiver.update_next_frame();
+	REQUIRE(received == std::vector<int>{ 1, 2 });
+
+	// Slots were released by the batch
+	REQUIRE(link.send(3));
+}
+
+reactor_coroutine<> send_sequence(reactor_link<int>& link, int count, int per_frame)
+{
+	int next = 0;
+	while (next < count)
+	{
+		for (int i = 0; i < per_frame && next < count; i++)
+		{
+			if (!link.send(next))
+				break;
+			next++;
+		}
+		co_await next_frame{};
+	}
+}
+
+reactor_coroutine<> receive_sequence(reactor_link<int>& link, int count, bool& ordered, std::atomic<bool>& done)
+{
+	int expected = 0;
+	while (expected < count)
+	{
+		auto batch = co_await link.receive_batch();
+		for (auto value : batch)
+		{
+			ordered = ordered && value == expected;
+			expected++;
+		}
+	}
+	done = true;
+}
+
+TEST_CASE("Link between threads", "[reactor_link]") {
+
+#ifdef _DEBUG
+	const int count = 100'000;
+#else
+	const int count = 2'000'000;
+#endif
+
+	reactor_scheduler<> sender;
+	reactor_scheduler<> receiver;
+	reactor_link<int> link(sender, receiver, 4096);
+
+	bool ordered = true;
+	std::atomic<bool> done{ false };
+
+	auto send = send_sequence(link, count, 1024);
+	auto receive = receive_sequence(link, count, ordered, done);
+	sender.push(send);
+	receiver.push(receive);
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	std::thread sender_thread([&] {
+		while (!done)
+		{
+			sender.update_next_frame();
+			std::this_thread::yield();
+		}
+	});
+	std::thread receiver_thread([&] {
+		while (!done)
+		{
+			receiver.update_next_frame();
+			std::this_thread::yield();
+		}
+	});
+	sender_thread.join();
+	receiver_thread.join();
+
+	std::chrono::duration<double> duration = std::chrono::high_resolution_clock::now() - start;
+	std::cout << "Link messages " << count / duration.count() / 1'000'000 << "M/s" << std::endl;
+
+	REQUIRE(ordered);
+}
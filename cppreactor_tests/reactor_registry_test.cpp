@@ -0,0 +1,113 @@
+#include "catch.hpp"
+#include <vector>
+#include "../cppreactor/reactor_registry.hpp"
+
+using namespace cppcoro;
+
+typedef reactor_coroutine<reactor_default_frame_data, reactor_registry> registered_coroutine;
+
+registered_coroutine registered_child()
+{
+	co_await next_frame{};
+}
+
+registered_coroutine registered_parent()
+{
+	co_await registered_child();
+	co_await next_frame{};
+}
+
+TEST_CASE("Registry tracks coroutine states", "[reactor_registry]") {
+
+	reactor_scheduler<reactor_default_frame_data, reactor_registry> s;
+	auto& registry = s.instrumentation<reactor_registry>();
+
+	auto a = registered_parent();
+	s.push(a);
+	auto id = registry.id_of(a);
+	REQUIRE(registry.contains(id));
+	REQUIRE(registry.state(id) == reactor_coroutine_state::scheduled);
+	REQUIRE(registry.size() == 1);
+
+	s.update_next_frame();
+	REQUIRE(registry.size() == 2);
+	REQUIRE(registry.state(id) == reactor_coroutine_state::suspended);
+	REQUIRE(registry.resume_frame(id) == 1);
+
+	auto counts = registry.count_by_state();
+	REQUIRE(counts[static_cast<std::size_t>(reactor_coroutine_state::suspended)] == 2);
+
+	REQUIRE(registry.set_priority(id, 7));
+	REQUIRE(registry.priority(id) == 7);
+
+	// Child completed and was released by its awaiter
+	s.update_next_frame();
+	REQUIRE(registry.size() == 1);
+
+	s.update_next_frame();
+	REQUIRE(a.done());
+	REQUIRE(registry.state(id) == reactor_coroutine_state::completed);
+}
+
+TEST_CASE("Registry ids of released coroutines are stale", "[reactor_registry]") {
+
+	reactor_scheduler<reactor_default_frame_data, reactor_registry> s;
+	auto& registry = s.instrumentation<reactor_registry>();
+
+	reactor_coroutine_id first;
+	{
+		auto a = registered_child();
+		s.push(a);
+		first = registry.id_of(a);
+		s.update_next_frame();
+		s.update_next_frame();
+		REQUIRE(a.done());
+	}
+	REQUIRE(!registry.contains(first));
+	REQUIRE(registry.size() == 0);
+	REQUIRE(!registry.set_priority(first, 1));
+
+	// Slot is reused with a new generation
+	auto b = registered_child();
+	s.push(b);
+	auto second = registry.id_of(b);
+	REQUIRE(second.m_index == first.m_index);
+	REQUIRE(second != first);
+	REQUIRE(!registry.contains(first));
+	REQUIRE(registry.contains(second));
+	REQUIRE(registry.address(first) == nullptr);
+	s.update_next_frame();
+	s.update_next_frame();
+}
+
+TEST_CASE("Registry enumerates and filters idle coroutines", "[reactor_registry]") {
+
+	reactor_scheduler<reactor_default_frame_data, reactor_registry> s;
+	auto& registry = s.instrumentation<reactor_registry>();
+
+	std::vector<registered_coroutine> coroutines;
+	for (int i = 0; i < 100; i++)
+	{
+		coroutines.push_back(registered_child());
+		s.push(coroutines.back());
+	}
+
+	std::size_t count = 0;
+	registry.for_each([&](reactor_coroutine_id id)
+	{
+		REQUIRE(registry.contains(id));
+		count++;
+	});
+	REQUIRE(count == 100);
+
+	s.update_next_frame();
+	std::size_t idle = 0;
+	registry.for_each_idle(0, [&](reactor_coroutine_id) { idle++; });
+	REQUIRE(idle == 0);
+
+	s.update_next_frame();
+	s.update_next_frame();
+	s.update_next_frame();
+	registry.for_each_idle(1, [&](reactor_coroutine_id) { idle++; });
+	REQUIRE(idle == 100);
+}
@@ -0,0 +1,118 @@
+#include "catch.hpp"
+#include <algorithm>
+#include <iostream>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "../cppreactor/reactor_scheduler_group.hpp"
+
+using namespace cppcoro;
+
+reactor_coroutine<const int&> count_group_frames(int& frames, int& last_data, std::thread::id& thread)
+{
+	for (;;)
+	{
+		auto& data = co_await next_frame<const int&>{};
+		frames++;
+		last_data = data;
+		thread = std::this_thread::get_id();
+	}
+}
+
+TEST_CASE("Scheduler group ticks all schedulers in lockstep", "[reactor_scheduler_group]") {
+
+	const int count = 4;
+	reactor_scheduler_group<const int&> group(count);
+	REQUIRE(group.size() == count);
+
+	std::vector<int> frames(count), last_data(count);
+	std::vector<std::thread::id> threads(count);
+	std::vector<reactor_coroutine<const int&> > coroutines;
+	for (int i = 0; i < count; i++)
+	{
+		coroutines.push_back(count_group_frames(frames[i], last_data[i], threads[i]));
+	}
+	for (int i = 0; i < count; i++)
+	{
+		group[i].push(coroutines[i]);
+	}
+
+	for (int frame = 0; frame < 10; frame++)
+	{
+		group.update_next_frame(frame);
+	}
+	REQUIRE(group.frame() == 10);
+
+	for (int i = 0; i < count; i++)
+	{
+		// First frame only starts coroutines
+		REQUIRE(frames[i] == 9);
+		REQUIRE(last_data[i] == 9);
+		REQUIRE(threads[i] != std::this_thread::get_id());
+		for (int j = 0; j < i; j++)
+		{
+			REQUIRE(threads[i] != threads[j]);
+		}
+	}
+}
+
+reactor_coroutine<> group_throws_start()
+{
+	throw std::runtime_error("group");
+	co_await next_frame{};
+}
+
+TEST_CASE("Scheduler group rethrows on calling thread", "[reactor_scheduler_group]") {
+
+	reactor_scheduler_group<> group(2);
+	auto c = group_throws_start();
+	group[1].push(c);
+
+	REQUIRE_THROWS_AS(group.update_next_frame(), std::runtime_error);
+
+	// Group keeps working after exception
+	group.update_next_frame();
+	REQUIRE(group.frame() == 2);
+}
+
+reactor_coroutine<> group_infinite_frames()
+{
+	for (;;)
+		co_await next_frame{};
+}
+
+TEST_CASE("Scheduler group speed", "[reactor_scheduler_group]") {
+
+	const std::size_t count = std::max(2u, std::thread::hardware_concurrency());
+	const int coroutines_per_scheduler = 10'000;
+
+#ifdef _DEBUG
+	const int frames = 10;
+#else
+	const int frames = 200;
+#endif
+
+	reactor_scheduler_group<> group(count);
+	std::vector<reactor_coroutine<> > coroutines;
+	for (std::size_t i = 0; i < count * coroutines_per_scheduler; i++)
+	{
+		coroutines.push_back(group_infinite_frames());
+	}
+	for (std::size_t i = 0; i < coroutines.size(); i++)
+	{
+		group[i % count].push(coroutines[i]);
+	}
+	group.update_next_frame();
+
+	auto start = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < frames; i++)
+	{
+		group.update_next_frame();
+	}
+	std::chrono::duration<double> duration = std::chrono::high_resolution_clock::now() - start;
+
+	auto updates_per_second = frames * coroutines.size() / duration.count();
+	std::cout << "Scheduler group " << count << " threads, " << frames / duration.count() << " frames/s, coroutine updates " << updates_per_second / 1'000'000 << "M/s" << std::endl;
+	REQUIRE(group.frame() == frames + 1);
+}
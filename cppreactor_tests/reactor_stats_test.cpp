@@ -0,0 +1,106 @@
+#include "catch.hpp"
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "../cppreactor/reactor_stats.hpp"
+
+using namespace cppcoro;
+
+typedef reactor_scheduler<reactor_default_frame_data, reactor_stats> stats_scheduler;
+typedef reactor_coroutine<reactor_default_frame_data, reactor_stats> stats_coroutine;
+
+// Without instrumentation the promise holds only scheduler, exception and continuation
+static_assert(sizeof(detail::reactor_coroutine_promise<>) == 2 * sizeof(void*) + sizeof(std::exception_ptr),
+	"Instrumentation must not take space when disabled");
+
+// Accessors of optional policies exist only on schedulers that have them
+template <class Scheduler>
+constexpr bool has_stats = requires(Scheduler& s) { s.stats(); };
+static_assert(has_stats<stats_scheduler> && !has_stats<reactor_scheduler<> >);
+
+stats_coroutine busy_frames(std::chrono::microseconds busy)
+{
+	for (;;)
+	{
+		auto end = std::chrono::steady_clock::now() + busy;
+		while (std::chrono::steady_clock::now() < end)
+		{
+		}
+		co_await next_frame{};
+	}
+}
+
+TEST_CASE("Stats report coroutines using most resume time", "[reactor_stats]") {
+
+	stats_scheduler s;
+
+	std::vector<stats_coroutine> light;
+	for (int i = 0; i < 5; i++)
+	{
+		light.push_back(busy_frames(std::chrono::microseconds(0)));
+	}
+	auto heavy = busy_frames(std::chrono::microseconds(200));
+
+	for (auto& c : light)
+	{
+		s.push(c);
+	}
+	s.push(heavy);
+
+	for (int i = 0; i < 10; i++)
+	{
+		s.update_next_frame();
+	}
+
+	auto stats = s.stats(3);
+	REQUIRE(stats.size() == 3);
+	REQUIRE(stats[0].m_resumes == 10);
+	REQUIRE(stats[0].m_frames_alive == 10);
+	REQUIRE(stats[0].m_total_resume_time >= std::chrono::microseconds(2000));
+	REQUIRE(stats[0].m_max_resume_time >= std::chrono::microseconds(200));
+	REQUIRE(stats[1].m_total_resume_time < stats[0].m_total_resume_time);
+
+	REQUIRE(s.stats(100).size() == 6);
+}
+
+reactor_coroutine_return<int, reactor_default_frame_data, reactor_stats> wait_frames(int frames)
+{
+	for (int i = 0; i < frames; i++)
+	{
+		co_await next_frame{};
+	}
+	co_return frames;
+}
+
+stats_coroutine await_children(int& result)
+{
+	result = co_await wait_frames(3);
+	result += co_await wait_frames(2);
+	co_await next_frame{};
+}
+
+TEST_CASE("Stats count frames spent waiting on children", "[reactor_stats]") {
+
+	stats_scheduler s;
+	int result = 0;
+	auto c = await_children(result);
+	s.push(c);
+
+	for (int i = 0; i < 6; i++)
+	{
+		s.update_next_frame();
+	}
+	REQUIRE(result == 5);
+
+	// Children are destroyed with their awaitables, parent is the only live coroutine
+	auto stats = s.stats();
+	REQUIRE(stats.size() == 1);
+	REQUIRE(stats[0].m_frames_waiting_on_children == 5);
+	REQUIRE(stats[0].m_resumes == 3);
+
+	s.update_next_frame();
+	REQUIRE(c.done());
+	c = stats_coroutine();
+	REQUIRE(s.stats().empty());
+}
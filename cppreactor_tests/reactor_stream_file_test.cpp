@@ -0,0 +1,116 @@
+#include "catch.hpp"
+#include "../cppreactor/reactor_stream_file.hpp"
+
+#include <filesystem>
+#include <fstream>
+
+using namespace cppcoro;
+
+namespace
+{
+	// Fixture files live in the temporary directory, not the working directory
+	std::string temporary_path(const char* file_name)
+	{
+		return (std::filesystem::temp_directory_path() / file_name).string();
+	}
+
+	struct test_file
+	{
+		test_file(const char* file_name, std::size_t size)
+			: name(temporary_path(file_name))
+		{
+			std::ofstream out(name, std::ios::binary);
+			for (std::size_t i = 0; i < size; i++)
+			{
+				out.put(static_cast<char>(i % 251));
+			}
+		}
+
+		~test_file()
+		{
+			std::error_code error;
+			std::filesystem::remove(name, error);
+		}
+
+		std::string name;
+	};
+}
+
+reactor_coroutine<> load_file(std::string path, std::size_t bytes_per_frame, reactor_file_buffer& result, bool& done)
+{
+	result = co_await stream_file(path, bytes_per_frame);
+	done = true;
+}
+
+TEST_CASE("Stream file spreads loading over frames", "[reactor_stream_file]") {
+
+	test_file file("cppreactor_stream_file_test.bin", 10000);
+
+	reactor_scheduler<> s;
+	reactor_file_buffer buffer;
+	bool done = false;
+
+	auto c = load_file(file.name, 4096, buffer, done);
+	s.push(c);
+
+	// Three chunks of at most 4096 bytes, one per frame
+	s.update_next_frame();
+	REQUIRE(done == false);
+	s.update_next_frame();
+	REQUIRE(done == false);
+	s.update_next_frame();
+	REQUIRE(done == true);
+
+	REQUIRE(buffer.size() == 10000);
+	bool same = true;
+	for (std::size_t i = 0; i < buffer.size(); i++)
+	{
+		same = same && buffer.data()[i] == static_cast<char>(i % 251);
+	}
+	REQUIRE(same);
+
+#ifdef REACTOR_STREAM_FILE_MMAP
+	REQUIRE(buffer.is_mapped());
+	REQUIRE(buffer.span().data() == buffer.data());
+#endif
+}
+
+TEST_CASE("Stream file empty file", "[reactor_stream_file]") {
+
+	test_file file("cppreactor_stream_file_empty.bin", 0);
+
+	reactor_scheduler<> s;
+	reactor_file_buffer buffer;
+	bool done = false;
+
+	auto c = load_file(file.name, 4096, buffer, done);
+	s.push(c);
+	s.update_next_frame();
+
+	REQUIRE(done == true);
+	REQUIRE(buffer.empty());
+	REQUIRE(buffer.is_mapped() == false);
+}
+
+reactor_coroutine<> load_missing_file(bool& caught)
+{
+	try {
+		co_await stream_file(temporary_path("cppreactor_stream_file_missing.bin"), 4096);
+	}
+	catch (std::system_error&)
+	{
+		caught = true;
+	}
+}
+
+TEST_CASE("Stream file missing file throws", "[reactor_stream_file]") {
+
+	reactor_scheduler<> s;
+	bool caught = false;
+
+	auto c = load_missing_file(caught);
+	s.push(c);
+	s.update_next_frame();
+
+	REQUIRE(caught == true);
+}
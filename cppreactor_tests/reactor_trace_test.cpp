@@ -0,0 +1,168 @@
+#include "catch.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include "../cppreactor/reactor_trace.hpp"
+#include "../cppreactor/reactor_stats.hpp"
+
+using namespace cppcoro;
+
+typedef reactor_coroutine<reactor_default_frame_data, reactor_trace> trace_coroutine;
+
+static std::size_t count_of(const std::string& text, const std::string& pattern)
+{
+	std::size_t count = 0;
+	for (auto position = text.find(pattern); position != std::string::npos; position = text.find(pattern, position + 1))
+	{
+		count++;
+	}
+	return count;
+}
+
+trace_coroutine traced_child()
+{
+	co_await next_frame{};
+}
+
+trace_coroutine traced_parent()
+{
+	co_await traced_child();
+	co_await next_frame{};
+}
+
+TEST_CASE("Trace records resumes with nesting parent", "[reactor_trace]") {
+
+	reactor_scheduler<reactor_default_frame_data, reactor_trace> s;
+	auto c = traced_parent();
+	s.push(c);
+
+	for (int i = 0; i < 3; i++)
+	{
+		s.update_next_frame();
+	}
+
+	auto& trace = s.instrumentation<reactor_trace>();
+	REQUIRE(trace.dropped() == 0);
+
+	std::ostringstream out;
+	trace.write_chrome_trace(out);
+	auto json = out.str();
+
+	REQUIRE(json.find("{\"traceEvents\":[") == 0);
+	REQUIRE(count_of(json, "\"name\":\"frame ") == 6);
+
+	// Parent: start, after child, after next frame. Child: start, after next frame.
+	REQUIRE(count_of(json, "\"ph\":\"B\",\"name\":\"coroutine 1\"") == 3);
+	REQUIRE(count_of(json, "\"ph\":\"B\",\"name\":\"coroutine 2\"") == 2);
+	REQUIRE(count_of(json, "\"ph\":\"E\",\"name\":\"coroutine 2\"") == 2);
+	REQUIRE(count_of(json, "\"id\":2,\"parent\":1") == 4);
+	REQUIRE(count_of(json, "\"id\":1,\"parent\":0") == 6);
+}
+
+TEST_CASE("Trace ring keeps latest events", "[reactor_trace]") {
+
+	reactor_scheduler<reactor_default_frame_data, reactor_trace> s;
+	auto& trace = s.instrumentation<reactor_trace>();
+	trace.set_capacity(8);
+
+	for (int i = 0; i < 10; i++)
+	{
+		s.update_next_frame();
+	}
+	REQUIRE(trace.size() == 8);
+	REQUIRE(trace.dropped() == 12);
+
+	std::ostringstream out;
+	write_chrome_trace(out, { &trace, &trace });
+	REQUIRE(count_of(out.str(), "\"tid\":1") == 8);
+	REQUIRE(count_of(out.str(), "frame 10") == 4);
+}
+
+trace_coroutine traced_loop()
+{
+	for (;;)
+		co_await next_frame{};
+}
+
+// Timestamp of the last event line containing pattern
+static std::string timestamp_of(const std::string& json, const std::string& pattern)
+{
+	auto line = json.rfind(pattern);
+	auto ts = json.rfind("\"ts\":", line) + 5;
+	return json.substr(ts, json.find(',', ts) - ts);
+}
+
+TEST_CASE("Trace resume after a suspend shares its timestamp", "[reactor_trace]") {
+
+	reactor_scheduler<reactor_default_frame_data, reactor_trace> s;
+	auto first = traced_loop();
+	auto second = traced_loop();
+	s.push(first);
+	s.push(second);
+
+	s.update_next_frame();
+	s.update_next_frame();
+
+	std::ostringstream out;
+	s.instrumentation<reactor_trace>().write_chrome_trace(out);
+	auto json = out.str();
+
+	REQUIRE(timestamp_of(json, "\"ph\":\"B\",\"name\":\"coroutine 2\"") == timestamp_of(json, "\"ph\":\"E\",\"name\":\"coroutine 1\""));
+
+	// Disabled trace records nothing
+	auto& trace = s.instrumentation<reactor_trace>();
+	trace.clear();
+	trace.set_enabled(false);
+	s.update_next_frame();
+	REQUIRE(trace.size() == 0);
+	trace.set_enabled(true);
+	s.update_next_frame();
+	REQUIRE(trace.size() == 6);
+}
+
+template <class... Policies>
+reactor_coroutine<reactor_default_frame_data, Policies...> traced_frames()
+{
+	for (;;)
+		co_await next_frame{};
+}
+
+template <class... Policies>
+std::chrono::duration<double, std::nano> frames_duration(reactor_scheduler<reactor_default_frame_data, Policies...>& s, int loops)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < loops; i++)
+	{
+		s.update_next_frame();
+	}
+	return std::chrono::high_resolution_clock::now() - start;
+}
+
+TEST_CASE("Trace event speed", "[reactor_trace]") {
+
+	reactor_scheduler<reactor_default_frame_data, reactor_trace, reactor_stats> s;
+	auto c = traced_frames<reactor_trace, reactor_stats>();
+	s.push(c);
+
+	reactor_scheduler<reactor_default_frame_data, reactor_stats> untraced;
+	auto u = traced_frames<reactor_stats>();
+	untraced.push(u);
+
+#ifdef _DEBUG
+	const int loops = 10'000;
+#else
+	const int loops = 1'000'000;
+#endif
+
+	auto duration = frames_duration(s, loops);
+	auto untraced_duration = frames_duration(untraced, loops);
+
+	// Frame begin, resume, suspend and frame end, cost of the same frames without trace is taken out
+	auto ns_per_event = (duration - untraced_duration).count() / (loops * 4.0);
+	std::cout << "Trace event " << ns_per_event << "ns" << std::endl;
+
+	REQUIRE(s.stats(1)[0].m_resumes == loops);
+	REQUIRE(s.instrumentation<reactor_trace>().size() == std::min<std::size_t>(4 * loops, 1 << 16));
+}
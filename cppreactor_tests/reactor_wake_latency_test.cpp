@@ -0,0 +1,156 @@
+#include "catch.hpp"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "../cppreactor/reactor_wake_latency.hpp"
+
+using namespace cppcoro;
+
+typedef reactor_scheduler<reactor_default_frame_data, reactor_wake_latency> latency_scheduler;
+typedef reactor_coroutine<reactor_default_frame_data, reactor_wake_latency> latency_coroutine;
+
+// Queues awaiting coroutine right away under its own source name
+struct wake_immediately
+{
+	latency_scheduler* m_scheduler;
+
+	bool await_ready() const noexcept
+	{
+		return false;
+	}
+
+	void await_suspend(detail::coro::coroutine_handle<> awaitingCoroutine)
+	{
+		m_scheduler->enqueue_update(awaitingCoroutine, "custom");
+	}
+
+	void await_resume()
+	{
+	}
+};
+
+latency_coroutine wait_frames(latency_scheduler& s)
+{
+	for (;;)
+	{
+		co_await next_frame{};
+		co_await wake_immediately{ &s };
+	}
+}
+
+TEST_CASE("Wake latency is kept per source", "[reactor_wake_latency]") {
+
+	latency_scheduler s;
+	auto c = wait_frames(s);
+	s.push(c);
+
+	for (int i = 0; i < 6; i++)
+	{
+		s.update_next_frame();
+		std::this_thread::sleep_for(std::chrono::milliseconds(2));
+	}
+
+	auto& latency = s.instrumentation<reactor_wake_latency>();
+	REQUIRE(latency.latencies().size() == 3);
+
+	auto push = latency.latency("push");
+	auto next = latency.latency("next_frame");
+	auto custom = latency.latency("custom");
+	REQUIRE(push != nullptr);
+	REQUIRE(next != nullptr);
+	REQUIRE(custom != nullptr);
+	REQUIRE(latency.latency("reactor_io") == nullptr);
+
+	REQUIRE(push->count() == 1);
+	REQUIRE(next->count() + custom->count() == 5);
+
+	// Every wake waited for the sleep between frames
+	REQUIRE(next->min() >= 2'000'000);
+	REQUIRE(custom->min() >= 2'000'000);
+}
+
+typedef reactor_scheduler<reactor_default_frame_data, reactor_wake_latency, reactor_thread_safe_enqueue> shared_latency_scheduler;
+typedef reactor_coroutine<reactor_default_frame_data, reactor_wake_latency, reactor_thread_safe_enqueue> shared_latency_coroutine;
+
+// Hands the awaiting coroutine to a thread that queues it
+struct hand_to_thread
+{
+	std::atomic<void*>* m_waiting;
+
+	bool await_ready() const noexcept
+	{
+		return false;
+	}
+
+	void await_suspend(detail::coro::coroutine_handle<> awaitingCoroutine)
+	{
+		m_waiting->store(awaitingCoroutine.address(), std::memory_order_release);
+		m_waiting->notify_one();
+	}
+
+	void await_resume()
+	{
+	}
+};
+
+shared_latency_coroutine wait_handed(std::atomic<void*>& waiting, int wakes, bool& done)
+{
+	for (int i = 0; i < wakes; i++)
+	{
+		co_await hand_to_thread{ &waiting };
+	}
+	done = true;
+}
+
+shared_latency_coroutine spin_until(bool& done)
+{
+	while (!done)
+	{
+		co_await next_frame{};
+	}
+}
+
+TEST_CASE("Wake latency keeps stamps of handles queued from other threads", "[reactor_wake_latency]") {
+
+	const int wakes = 2000;
+	shared_latency_scheduler s;
+	std::atomic<void*> waiting{ nullptr };
+	bool done = false;
+
+	auto waiter = wait_handed(waiting, wakes, done);
+	auto spinner = spin_until(done);
+	s.push(waiter);
+	s.push(spinner);
+
+	std::atomic<bool> stop{ false };
+	std::thread thread([&] {
+		for (;;)
+		{
+			// Sleeps until a handle is handed over, spinning would starve a single core
+			waiting.wait(nullptr, std::memory_order_acquire);
+			auto address = waiting.exchange(nullptr, std::memory_order_acquire);
+			if (stop)
+			{
+				break;
+			}
+			s.enqueue_update(detail::coro::coroutine_handle<>::from_address(address), "thread");
+		}
+	});
+
+	auto start = std::chrono::steady_clock::now();
+	while (!done && std::chrono::steady_clock::now() - start < std::chrono::seconds(10))
+	{
+		s.update_next_frame();
+		std::this_thread::yield();
+	}
+	stop = true;
+	waiting.store(&stop, std::memory_order_release);
+	waiting.notify_one();
+	thread.join();
+	REQUIRE(done);
+
+	// Every wake from the thread was measured, none was lost to a frame skipped as misaligned
+	auto thread_latency = s.instrumentation<reactor_wake_latency>().latency("thread");
+	REQUIRE(thread_latency != nullptr);
+	REQUIRE(thread_latency->count() == wakes);
+}
@@ -0,0 +1,98 @@
+#include "catch.hpp"
+#include <chrono>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../cppreactor/reactor_watchdog.hpp"
+
+using namespace cppcoro;
+
+typedef reactor_coroutine<reactor_default_frame_data, reactor_watchdog> watched_coroutine;
+
+watched_coroutine forgets_to_yield(int frame, std::chrono::milliseconds busy)
+{
+	for (int i = 0;; i++)
+	{
+		if (i == frame)
+		{
+			auto end = std::chrono::steady_clock::now() + busy;
+			while (std::chrono::steady_clock::now() < end)
+			{
+			}
+		}
+		co_await next_frame{};
+	}
+}
+
+watched_coroutine well_behaved()
+{
+	for (;;)
+		co_await next_frame{};
+}
+
+TEST_CASE("Watchdog reports coroutine that does not yield", "[reactor_watchdog]") {
+
+	std::mutex mutex;
+	std::vector<reactor_watchdog_report> reports;
+
+	reactor_scheduler<reactor_default_frame_data, reactor_watchdog> s;
+	s.instrumentation<reactor_watchdog>().start(std::chrono::milliseconds(20), [&](const reactor_watchdog_report& report)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		reports.push_back(report);
+	});
+
+	auto good = well_behaved();
+	auto bad = forgets_to_yield(2, std::chrono::milliseconds(200));
+	s.push(good);
+	s.push(bad);
+
+	for (int i = 0; i < 5; i++)
+	{
+		s.update_next_frame();
+	}
+	s.instrumentation<reactor_watchdog>().stop();
+
+	// Reported once even though it was stuck for several watchdog periods
+	REQUIRE(reports.size() == 1);
+	REQUIRE(reports[0].m_frame == 3);
+	REQUIRE(reports[0].m_running_for >= std::chrono::milliseconds(20));
+	REQUIRE(reports[0].m_coroutine != nullptr);
+#if defined(__cpp_lib_source_location)
+	REQUIRE(std::string(reports[0].m_function).find("forgets_to_yield") != std::string::npos);
+	REQUIRE(std::string(reports[0].m_file).find("reactor_watchdog_test.cpp") != std::string::npos);
+	REQUIRE(reports[0].m_line > 0);
+#endif
+}
+
+watched_coroutine throws_after_frame()
+{
+	co_await next_frame{};
+	throw std::exception();
+}
+
+TEST_CASE("Watchdog does not report after a resume throws", "[reactor_watchdog]") {
+
+	std::mutex mutex;
+	std::vector<reactor_watchdog_report> reports;
+
+	reactor_scheduler<reactor_default_frame_data, reactor_watchdog> s;
+	s.instrumentation<reactor_watchdog>().start(std::chrono::milliseconds(20), [&](const reactor_watchdog_report& report)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		reports.push_back(report);
+	});
+
+	auto thrower = throws_after_frame();
+	s.push(thrower);
+	s.update_next_frame();
+	REQUIRE_THROWS(s.update_next_frame());
+
+	// Nothing runs while the scheduler idles, the throwing resume ended with the exception
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	s.instrumentation<reactor_watchdog>().stop();
+
+	REQUIRE(reports.empty());
+}